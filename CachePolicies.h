@@ -0,0 +1,457 @@
+#pragma once
+// Политики вытеснения с тем же интерфейсом, что у LRUCache: get(key, value) - найти и учесть
+// обращение, put(key, value) - вставить или обновить, contains, size, capacity.
+// В отличие от LRU они устойчивы к однократному проходу по множеству новых ключей:
+//   ClockCache    - CLOCK: бит обращения вместо перестановки в списке (приближение LRU)
+//   SLRUCache     - сегментированный LRU: новые ключи в испытательном сегменте, повторно
+//                   использованные - в защищённом
+//   TwoQueueCache - 2Q: FIFO для новых ключей, призрачная очередь вытесненных из неё, LRU для
+//                   ключей, к которым обратились снова
+//   ARCCache      - ARC: размер частей "недавние" / "частые" подстраивается по призрачным спискам
+//   WTinyLFUCache - W-TinyLFU: небольшое LRU-окно и SLRU, ключ из окна попадает в SLRU, только
+//                   если по count-min sketch он встречался чаще, чем кандидат на вытеснение
+#include "LRUCache.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// CLOCK: элементы стоят по кругу, стрелка ищет элемент без бита обращения и сбрасывает биты
+// у тех, мимо кого проходит
+template <typename K, typename V, typename Hash = std::hash<K>>
+class ClockCache {
+private:
+    struct Slot {
+        K key;
+        V value;
+        bool referenced;
+    };
+
+    std::size_t maxSize;
+    std::vector<Slot> slots;
+    std::unordered_map<K, std::size_t, Hash> index;
+    std::size_t hand;
+
+public:
+    explicit ClockCache(std::size_t capacity) : maxSize(capacity), hand(0) {
+        slots.reserve(capacity);
+        index.reserve(capacity);
+    }
+
+    std::size_t size() const { return slots.size(); }
+    std::size_t capacity() const { return maxSize; }
+
+    bool get(const K& key, V& value) {
+        auto found = index.find(key);
+        if (found == index.end()) return false;
+        Slot& slot = slots[found->second];
+        slot.referenced = true;
+        value = slot.value;
+        return true;
+    }
+
+    void put(const K& key, const V& value) {
+        if (maxSize == 0) return;
+        auto found = index.find(key);
+        if (found != index.end()) {
+            slots[found->second].value = value;
+            slots[found->second].referenced = true;
+            return;
+        }
+        if (slots.size() < maxSize) {
+            index.emplace(key, slots.size());
+            slots.push_back(Slot{ key, value, false });
+            return;
+        }
+        while (slots[hand].referenced) { //второй шанс
+            slots[hand].referenced = false;
+            hand = (hand + 1) % maxSize;
+        }
+        index.erase(slots[hand].key);
+        slots[hand] = Slot{ key, value, false };
+        index.emplace(key, hand);
+        hand = (hand + 1) % maxSize;
+    }
+
+    bool contains(const K& key) const { return index.find(key) != index.end(); }
+};
+
+// Сегментированный LRU. Новый ключ попадает в начало испытательного сегмента, при повторном
+// обращении - в защищённый (не больше protectedShare ёмкости); вытесненный из защищённого
+// возвращается в испытательный. Жертва - конец испытательного сегмента
+template <typename K, typename V, typename Hash = std::hash<K>>
+class SLRUCache {
+private:
+    typedef std::list<std::pair<K, V>> List;
+
+    struct Position {
+        typename List::iterator item;
+        bool protectedSegment;
+    };
+
+    std::size_t maxSize;
+    std::size_t maxProtected;
+    List probation; //начало - последний использованный
+    List protectedList;
+    std::unordered_map<K, Position, Hash> index;
+
+    void promote(Position& position) {
+        if (position.protectedSegment) {
+            protectedList.splice(protectedList.begin(), protectedList, position.item);
+            return;
+        }
+        protectedList.splice(protectedList.begin(), probation, position.item);
+        position.protectedSegment = true;
+        if (protectedList.size() > maxProtected) {
+            auto last = std::prev(protectedList.end());
+            index.find(last->first)->second.protectedSegment = false;
+            probation.splice(probation.begin(), protectedList, last);
+        }
+    }
+
+public:
+    explicit SLRUCache(std::size_t capacity, double protectedShare = 0.8)
+        : maxSize(capacity), maxProtected(static_cast<std::size_t>(capacity * protectedShare)) {
+        index.reserve(capacity);
+    }
+
+    std::size_t size() const { return index.size(); }
+    std::size_t capacity() const { return maxSize; }
+
+    bool get(const K& key, V& value) {
+        auto found = index.find(key);
+        if (found == index.end()) return false;
+        promote(found->second);
+        value = found->second.item->second;
+        return true;
+    }
+
+    void put(const K& key, const V& value) {
+        if (maxSize == 0) return;
+        auto found = index.find(key);
+        if (found != index.end()) {
+            found->second.item->second = value;
+            promote(found->second);
+            return;
+        }
+        if (index.size() >= maxSize) evictVictim();
+        insert(key, value);
+    }
+
+    bool contains(const K& key) const { return index.find(key) != index.end(); }
+
+    // Для WTinyLFUCache: кто будет вытеснен следующим, вытеснение и вставка без вытеснения
+    const K& victimKey() const { return probation.empty() ? protectedList.back().first : probation.back().first; }
+
+    void evictVictim() {
+        List& from = probation.empty() ? protectedList : probation;
+        index.erase(from.back().first);
+        from.pop_back();
+    }
+
+    void insert(const K& key, const V& value) { //ключа нет и место есть
+        probation.emplace_front(key, value);
+        index.emplace(key, Position{ probation.begin(), false });
+    }
+};
+
+// 2Q (Johnson, Shasha). Новый ключ попадает в FIFO A1in (четверть ёмкости) и, если к нему
+// больше не обращались, уходит оттуда в призрачную очередь A1out (только ключи, половина
+// ёмкости). Ключ, найденный в A1out, считается повторно используемым и попадает в LRU Am
+template <typename K, typename V, typename Hash = std::hash<K>>
+class TwoQueueCache {
+private:
+    typedef std::list<std::pair<K, V>> List;
+    enum Queue { IN, OUT, MAIN };
+
+    struct Position {
+        typename List::iterator item;
+        Queue queue;
+    };
+
+    std::size_t maxSize;
+    std::size_t maxIn;
+    std::size_t maxOut;
+    List in; //начало - новые
+    List out; //значения не хранятся
+    List main;
+    std::unordered_map<K, Position, Hash> index;
+
+    // Освободить место под новый ключ
+    void reclaim() {
+        if (in.size() + main.size() < maxSize) return;
+        if (in.size() > maxIn || main.empty()) {
+            auto last = std::prev(in.end());
+            last->second = V();
+            index.find(last->first)->second.queue = OUT;
+            out.splice(out.begin(), in, last);
+            if (out.size() > maxOut) {
+                index.erase(out.back().first);
+                out.pop_back();
+            }
+        }
+        else {
+            index.erase(main.back().first);
+            main.pop_back();
+        }
+    }
+
+public:
+    explicit TwoQueueCache(std::size_t capacity)
+        : maxSize(capacity), maxIn(std::max<std::size_t>(capacity / 4, 1)), maxOut(std::max<std::size_t>(capacity / 2, 1)) {
+        index.reserve(capacity + maxOut);
+    }
+
+    std::size_t size() const { return in.size() + main.size(); }
+    std::size_t capacity() const { return maxSize; }
+
+    bool get(const K& key, V& value) {
+        auto found = index.find(key);
+        if (found == index.end() || found->second.queue == OUT) return false;
+        if (found->second.queue == MAIN) main.splice(main.begin(), main, found->second.item);
+        value = found->second.item->second; //в A1in порядок не меняется
+        return true;
+    }
+
+    void put(const K& key, const V& value) {
+        if (maxSize == 0) return;
+        auto found = index.find(key);
+        if (found != index.end() && found->second.queue != OUT) {
+            found->second.item->second = value;
+            if (found->second.queue == MAIN) main.splice(main.begin(), main, found->second.item);
+            return;
+        }
+        bool reused = found != index.end(); //ключ из A1out - пойдёт в Am
+        if (reused) { //убираем до reclaim: та может укоротить A1out
+            out.erase(found->second.item);
+            index.erase(found);
+        }
+        reclaim();
+        List& target = reused ? main : in;
+        target.emplace_front(key, value);
+        index.emplace(key, Position{ target.begin(), reused ? MAIN : IN });
+    }
+
+    bool contains(const K& key) const {
+        auto found = index.find(key);
+        return found != index.end() && found->second.queue != OUT;
+    }
+};
+
+// ARC (Megiddo, Modha). T1 - ключи, к которым обратились один раз, T2 - больше одного раза;
+// B1 и B2 - призрачные списки ключей, вытесненных из T1 и T2. Попадание в B1 увеличивает
+// целевой размер T1 (p), попадание в B2 - уменьшает
+template <typename K, typename V, typename Hash = std::hash<K>>
+class ARCCache {
+private:
+    typedef std::list<std::pair<K, V>> List;
+    enum Part { T1, T2, B1, B2 };
+
+    struct Position {
+        typename List::iterator item;
+        Part part;
+    };
+
+    std::size_t maxSize;
+    std::size_t target; //p - целевой размер T1
+    List lists[4]; //начало каждого - последний использованный
+    std::unordered_map<K, Position, Hash> index;
+
+    void moveTo(Position& position, Part part) {
+        lists[part].splice(lists[part].begin(), lists[position.part], position.item);
+        position.part = part;
+    }
+
+    void dropLast(Part part) {
+        index.erase(lists[part].back().first);
+        lists[part].pop_back();
+    }
+
+    // Вытеснить конец T1 в B1 или конец T2 в B2
+    void replace(bool inB2) {
+        if (lists[T1].size() + lists[T2].size() < maxSize) return;
+        std::size_t t1 = lists[T1].size();
+        Part from = t1 > 0 && (t1 > target || (inB2 && t1 == target) || lists[T2].empty()) ? T1 : T2;
+        auto last = std::prev(lists[from].end());
+        last->second = V();
+        moveTo(index.find(last->first)->second, from == T1 ? B1 : B2);
+    }
+
+public:
+    explicit ARCCache(std::size_t capacity) : maxSize(capacity), target(0) {
+        index.reserve(2 * capacity);
+    }
+
+    std::size_t size() const { return lists[T1].size() + lists[T2].size(); }
+    std::size_t capacity() const { return maxSize; }
+
+    bool get(const K& key, V& value) {
+        auto found = index.find(key);
+        if (found == index.end() || found->second.part == B1 || found->second.part == B2) return false;
+        moveTo(found->second, T2);
+        value = found->second.item->second;
+        return true;
+    }
+
+    void put(const K& key, const V& value) {
+        if (maxSize == 0) return;
+        auto found = index.find(key);
+        if (found != index.end()) {
+            Position& position = found->second;
+            if (position.part == B1) {
+                target = std::min(maxSize, target + std::max<std::size_t>(lists[B2].size() / lists[B1].size(), 1));
+                replace(false);
+            }
+            else if (position.part == B2) {
+                std::size_t step = std::max<std::size_t>(lists[B1].size() / lists[B2].size(), 1);
+                target = target > step ? target - step : 0;
+                replace(true);
+            }
+            position.item->second = value;
+            moveTo(position, T2);
+            return;
+        }
+        std::size_t l1 = lists[T1].size() + lists[B1].size();
+        std::size_t total = l1 + lists[T2].size() + lists[B2].size();
+        if (l1 >= maxSize) {
+            if (lists[T1].size() < maxSize) {
+                dropLast(B1);
+                replace(false);
+            }
+            else {
+                dropLast(T1);
+            }
+        }
+        else if (total >= maxSize) {
+            if (total >= 2 * maxSize) dropLast(B2);
+            replace(false);
+        }
+        lists[T1].emplace_front(key, value);
+        index.emplace(key, Position{ lists[T1].begin(), T1 });
+    }
+
+    bool contains(const K& key) const {
+        auto found = index.find(key);
+        return found != index.end() && (found->second.part == T1 || found->second.part == T2);
+    }
+};
+
+// Count-min sketch с 4-битными счётчиками (хранятся байтами, насыщаются на 15): оценка
+// частоты ключа - минимум по четырём строкам. После sampleSize добавлений все счётчики
+// делятся пополам, чтобы давняя популярность со временем забывалась
+class CountMinSketch {
+private:
+    static const int ROWS = 4;
+    static const unsigned char MAX_COUNT = 15;
+    std::vector<unsigned char> counters; //ROWS строк подряд
+    std::size_t mask; //ширина строки - 1
+    std::size_t additions;
+    std::size_t sampleSize;
+
+    std::size_t cell(std::uint64_t hash, int row) const {
+        std::uint64_t step = lruMixHash(hash) | 1; //вторая хеш-функция: строки - h + row * step
+        return row * (mask + 1) + static_cast<std::size_t>((hash + row * step) & mask);
+    }
+
+public:
+    explicit CountMinSketch(std::size_t capacity) : additions(0) {
+        std::size_t width = 16;
+        while (width < capacity) width *= 2;
+        counters.assign(ROWS * width, 0);
+        mask = width - 1;
+        sampleSize = 10 * std::max<std::size_t>(capacity, 1);
+    }
+
+    void increment(std::uint64_t hash) {
+        for (int row = 0; row < ROWS; row++) {
+            unsigned char& counter = counters[cell(hash, row)];
+            if (counter < MAX_COUNT) counter++;
+        }
+        if (++additions == sampleSize) {
+            for (unsigned char& counter : counters) counter >>= 1;
+            additions /= 2;
+        }
+    }
+
+    int frequency(std::uint64_t hash) const {
+        int result = MAX_COUNT;
+        for (int row = 0; row < ROWS; row++) result = std::min<int>(result, counters[cell(hash, row)]);
+        return result;
+    }
+};
+
+// W-TinyLFU (Einziger, Friedman, Manes). Новые ключи попадают в LRU-окно (1% ёмкости);
+// вытесненный из окна ключ переходит в основную часть (SLRU) только если частота по sketch
+// у него больше, чем у кандидата на вытеснение оттуда. Sketch учитывает каждый get
+template <typename K, typename V, typename Hash = std::hash<K>>
+class WTinyLFUCache {
+private:
+    typedef std::list<std::pair<K, V>> List;
+
+    Hash hasher;
+    std::size_t maxWindow;
+    List window; //начало - последний использованный
+    std::unordered_map<K, typename List::iterator, Hash> windowIndex;
+    SLRUCache<K, V, Hash> main;
+    CountMinSketch sketch;
+
+    static std::size_t windowSize(std::size_t capacity) { return capacity == 0 ? 0 : std::max<std::size_t>(capacity / 100, 1); }
+
+    int frequency(const K& key) const { return sketch.frequency(lruMixHash(static_cast<std::uint64_t>(hasher(key)))); }
+
+    // Самый старый ключ окна либо попадает в основную часть, либо пропадает
+    void evictFromWindow() {
+        std::pair<K, V>& candidate = window.back();
+        windowIndex.erase(candidate.first);
+        if (main.size() < main.capacity()) {
+            main.insert(candidate.first, candidate.second);
+        }
+        else if (main.capacity() > 0 && frequency(candidate.first) > frequency(main.victimKey())) {
+            main.evictVictim();
+            main.insert(candidate.first, candidate.second);
+        }
+        window.pop_back();
+    }
+
+public:
+    explicit WTinyLFUCache(std::size_t capacity)
+        : maxWindow(windowSize(capacity)), main(capacity - windowSize(capacity)), sketch(capacity) {
+        windowIndex.reserve(maxWindow + 1);
+    }
+
+    std::size_t size() const { return window.size() + main.size(); }
+    std::size_t capacity() const { return maxWindow + main.capacity(); }
+
+    bool get(const K& key, V& value) {
+        sketch.increment(lruMixHash(static_cast<std::uint64_t>(hasher(key))));
+        auto found = windowIndex.find(key);
+        if (found == windowIndex.end()) return main.get(key, value);
+        window.splice(window.begin(), window, found->second);
+        value = found->second->second;
+        return true;
+    }
+
+    void put(const K& key, const V& value) {
+        if (maxWindow == 0) return;
+        auto found = windowIndex.find(key);
+        if (found != windowIndex.end()) {
+            found->second->second = value;
+            window.splice(window.begin(), window, found->second);
+            return;
+        }
+        if (main.contains(key)) {
+            main.put(key, value);
+            return;
+        }
+        window.emplace_front(key, value);
+        windowIndex.emplace(key, window.begin());
+        if (window.size() > maxWindow) evictFromWindow();
+    }
+
+    bool contains(const K& key) const { return windowIndex.find(key) != windowIndex.end() || main.contains(key); }
+};
@@ -0,0 +1,104 @@
+#pragma once
+// Общие части замеров сжатия lr2n5 и proba: тестовые наборы данных и измерение скорости.
+// Оба замера берут одни и те же наборы, поэтому их результаты можно сравнивать между собой
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+const std::vector<std::string> CORPUS_NAMES = { "random", "zipf", "english", "cyrillic", "binary", "fibonacci" };
+
+// Функция для генерации тестового набора данных заданного размера.
+// Зерно фиксировано, поэтому при каждом запуске данные одинаковые
+inline std::string generateCorpus(const std::string& name, size_t size) {
+    std::mt19937 gen(20241019);
+    std::string result;
+    result.reserve(size + 64);
+
+    if (name == "random") {
+        // Равномерные байты - сжать нельзя
+        std::uniform_int_distribution<int> byte(0, 255);
+        while (result.size() < size) result.push_back((char)byte(gen));
+    }
+    else if (name == "zipf") {
+        // Байты с распределением Ципфа (s = 1.1)
+        std::vector<double> weights(256);
+        for (int k = 0; k < 256; k++) weights[k] = 1.0 / std::pow(k + 1, 1.1);
+        std::discrete_distribution<int> zipf(weights.begin(), weights.end());
+        while (result.size() < size) result.push_back((char)zipf(gen));
+    }
+    else if (name == "english" || name == "cyrillic") {
+        // Предложения из слов, частоты слов тоже по Ципфу
+        std::vector<std::string> words = name == "english"
+            ? std::vector<std::string>{ "the", "of", "and", "to", "a", "in", "is", "it", "that", "for", "was", "on",
+                "with", "as", "data", "tree", "code", "table", "hash", "value", "compression", "Huffman",
+                "symbol", "frequency", "stream", "block", "memory", "string", "node", "queue" }
+            : std::vector<std::string>{ "и", "в", "не", "на", "что", "с", "по", "это", "как", "к", "дерево", "код",
+                "таблица", "значение", "сжатие", "Хаффман", "символ", "частота", "поток", "блок", "память",
+                "строка", "узел", "очередь", "ёмкость", "кэш", "ключ", "щука", "объём", "съезд" };
+        std::vector<double> weights(words.size());
+        for (size_t k = 0; k < words.size(); k++) weights[k] = 1.0 / (k + 1);
+        std::discrete_distribution<int> pick(weights.begin(), weights.end());
+        std::uniform_int_distribution<int> sentenceLength(4, 16);
+        std::uniform_int_distribution<int> percent(0, 99);
+        while (result.size() < size) {
+            int n = sentenceLength(gen);
+            for (int i = 0; i < n; i++) {
+                result += words[pick(gen)];
+                if (i + 1 < n) result += percent(gen) < 5 ? ", " : " ";
+            }
+            result += percent(gen) < 10 ? ".\n" : ". ";
+        }
+    }
+    else if (name == "binary") {
+        // Записи по 12 байт: растущий номер, значение около 1000, флаги
+        uint32_t id = 0;
+        std::normal_distribution<double> value(1000, 50);
+        while (result.size() < size) {
+            id += 1 + gen() % 3;
+            uint32_t v = (uint32_t)(int32_t)value(gen);
+            uint32_t flags = gen() % 4;
+            for (uint32_t field : { id, v, flags }) {
+                for (int i = 0; i < 4; i++) result.push_back((char)(field >> (8 * i)));
+            }
+        }
+    }
+    else if (name == "fibonacci") {
+        // Частоты символов - числа Фибоначчи 1, 1, 2, 3, 5, ...: дерево Хаффмана вырождается
+        // в цепочку, и начиная с 34 символов коды длиннее 32 бит. Такой набор не короче
+        // 14.9 МБ, поэтому size здесь - нижняя граница
+        const std::string alphabet = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+        uint64_t previous = 0, count = 1;
+        for (size_t k = 0; k < alphabet.size() && (k < 34 || result.size() < size); k++) {
+            result.append((size_t)count, alphabet[k]);
+            uint64_t next = previous + count;
+            previous = count;
+            count = next;
+        }
+        std::shuffle(result.begin(), result.end(), gen);
+        size = result.size();
+    }
+    else {
+        throw std::runtime_error("Ошибка: неизвестный набор данных " + name);
+    }
+    result.resize(size);
+    return result;
+}
+
+// Функция для замера времени выполнения в микросекундах
+inline double measureMicroseconds(const std::function<void()>& run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Скорость в МБ/с по числу байтов и времени в микросекундах
+inline double megabytesPerSecond(size_t bytes, double microseconds) {
+    return bytes / std::max(microseconds, 1e-3);
+}
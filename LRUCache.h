@@ -0,0 +1,459 @@
+#pragma once
+// LRU-кэш как шаблон только из заголовка. Вынесен из LRUcache в lr2n7.cpp: операции не печатают
+// ничего и выполняются за O(1), каждая get/put ищет ключ в хеш-таблице один раз.
+// Для отладки можно передать параметр Trace - его методы вызываются при попадании, промахе,
+// вставке, обновлении и вытеснении. По умолчанию это NoLRUTrace с пустыми методами, которые
+// компилятор убирает целиком.
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Трассировка по умолчанию: ничего не делает
+struct NoLRUTrace {
+    template <typename K, typename V> void onHit(const K&, const V&) {}
+    template <typename K> void onMiss(const K&) {}
+    template <typename K, typename V> void onInsert(const K&, const V&) {}
+    template <typename K, typename V> void onUpdate(const K&, const V&) {}
+    template <typename K, typename V> void onEvict(const K&, const V&) {}
+};
+
+template <typename K, typename V, typename Hash = std::hash<K>, typename Trace = NoLRUTrace>
+class LRUCache {
+private:
+    // Элемент хранится прямо в узле unordered_map (адреса значений в нём не меняются
+    // при перестроении), поэтому на ключ приходится одно выделение памяти, а не два
+    struct Entry {
+        V value;
+        K key; //копия ключа узла - нужна при вытеснении и обходе
+        Entry* prev; //ближе к недавно использованным
+        Entry* next; //ближе к давно использованным
+    };
+
+    std::size_t maxSize;
+    std::unordered_map<K, Entry, Hash> entries;
+    Entry* head; //последний использованный
+    Entry* tail; //первый кандидат на вытеснение
+    Trace trace;
+
+    void unlink(Entry* entry) {
+        if (entry->prev != nullptr) entry->prev->next = entry->next;
+        else head = entry->next;
+        if (entry->next != nullptr) entry->next->prev = entry->prev;
+        else tail = entry->prev;
+    }
+
+    void pushFront(Entry* entry) {
+        entry->prev = nullptr;
+        entry->next = head;
+        if (head != nullptr) head->prev = entry;
+        else tail = entry;
+        head = entry;
+    }
+
+    void moveToFront(Entry* entry) {
+        if (entry == head) return;
+        unlink(entry);
+        pushFront(entry);
+    }
+
+public:
+    explicit LRUCache(std::size_t capacity, const Trace& trace = Trace())
+        : maxSize(capacity), head(nullptr), tail(nullptr), trace(trace) {
+        entries.reserve(capacity + 1); //новый ключ вставляется до вытеснения старого
+    }
+
+    // Узлы списка указывают друг на друга, поэтому копирование запрещено
+    LRUCache(const LRUCache&) = delete;
+    LRUCache& operator=(const LRUCache&) = delete;
+
+    std::size_t size() const { return entries.size(); }
+    std::size_t capacity() const { return maxSize; }
+    Trace& getTrace() { return trace; }
+
+    // Найти ключ и сделать его последним использованным. false - ключа нет, value не меняется
+    bool get(const K& key, V& value) {
+        auto found = entries.find(key);
+        if (found == entries.end()) {
+            trace.onMiss(key);
+            return false;
+        }
+        Entry& entry = found->second;
+        moveToFront(&entry);
+        value = entry.value;
+        trace.onHit(key, entry.value);
+        return true;
+    }
+
+    // Вставить или обновить значение; при переполнении вытесняется давно использованный ключ.
+    // operator[] ищет ключ один раз и создаёт узел только для нового ключа (emplace создал бы
+    // его и при обновлении), поэтому K и V должны иметь конструктор по умолчанию
+    void put(const K& key, const V& value) {
+        if (maxSize == 0) return;
+        std::size_t oldSize = entries.size();
+        Entry& entry = entries[key];
+        entry.value = value;
+        if (entries.size() == oldSize) { //ключ уже был
+            moveToFront(&entry);
+            trace.onUpdate(key, value);
+            return;
+        }
+        entry.key = key;
+        pushFront(&entry);
+        trace.onInsert(key, value);
+        if (entries.size() > maxSize) {
+            Entry* victim = tail;
+            unlink(victim);
+            trace.onEvict(victim->key, victim->value);
+            K victimKey = victim->key; //ссылка на ключ внутри удаляемого узла стала бы висячей
+            entries.erase(victimKey);
+        }
+    }
+
+    // Есть ли ключ, без изменения порядка
+    bool contains(const K& key) const { return entries.find(key) != entries.end(); }
+
+    // Обход от последнего использованного к давно использованному: f(key, value)
+    template <typename F>
+    void forEach(F f) const {
+        for (const Entry* entry = head; entry != nullptr; entry = entry->next) f(entry->key, entry->value);
+    }
+
+    void clear() {
+        entries.clear();
+        head = tail = nullptr;
+    }
+};
+
+// Перемешивание битов хеша (финализатор splitmix64): std::hash для целых возвращает сам ключ,
+// а индексу FixedLRUCache нужны случайные младшие биты
+inline std::uint64_t lruMixHash(std::uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+template <typename K, typename V, typename Hash> class ShardedLRUCache;
+
+// LRU-кэш без выделений памяти после конструктора. Все элементы лежат в одном массиве и
+// связаны в список 32-битными индексами; вытесненный элемент сразу занимает новый ключ.
+// Индекс ключ -> элемент - открытая адресация с линейным пробированием, заполненная не более
+// чем наполовину; удаление сдвигает следующие ячейки назад, поэтому удалённых ячеек нет.
+// Ячейка индекса хранит номер элемента и 32 бита хеша: по ним находится исходная ячейка
+// при сдвиге и отсеиваются чужие ключи без обращения к массиву элементов.
+// K и V должны иметь конструктор по умолчанию
+template <typename K, typename V, typename Hash = std::hash<K>, typename Trace = NoLRUTrace>
+class FixedLRUCache {
+private:
+    static const std::uint32_t NONE = 0xffffffffu;
+
+    struct Node {
+        K key;
+        V value;
+        std::uint32_t prev; //ближе к недавно использованным
+        std::uint32_t next; //ближе к давно использованным
+    };
+
+    struct Slot {
+        std::uint32_t node; //NONE - пусто
+        std::uint32_t hash;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Slot> index;
+    std::uint32_t mask; //размер индекса - 1 (степень двойки)
+    std::uint32_t used; //занятые элементы - nodes[0, used)
+    std::uint32_t head;
+    std::uint32_t tail;
+    Hash hasher;
+    Trace trace;
+
+    std::uint32_t hashOf(const K& key) const {
+        return static_cast<std::uint32_t>(lruMixHash(static_cast<std::uint64_t>(hasher(key))));
+    }
+
+    // Ячейка индекса с ключом, а если его нет - первая пустая ячейка на пути пробирования
+    std::uint32_t findSlot(const K& key, std::uint32_t hash) const {
+        std::uint32_t i = hash & mask;
+        while (index[i].node != NONE) {
+            if (index[i].hash == hash && nodes[index[i].node].key == key) return i;
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    // Удаление из индекса со сдвигом назад: каждая следующая ячейка переезжает в дыру,
+    // если дыра не раньше её исходной ячейки
+    void eraseSlot(std::uint32_t hole) {
+        std::uint32_t i = hole;
+        while (true) {
+            i = (i + 1) & mask;
+            if (index[i].node == NONE) break;
+            std::uint32_t home = index[i].hash & mask;
+            if (((i - home) & mask) >= ((i - hole) & mask)) { //расстояние до исходной не меньше, чем до дыры
+                index[hole] = index[i];
+                hole = i;
+            }
+        }
+        index[hole].node = NONE;
+    }
+
+    void unlink(std::uint32_t n) {
+        Node& node = nodes[n];
+        if (node.prev != NONE) nodes[node.prev].next = node.next;
+        else head = node.next;
+        if (node.next != NONE) nodes[node.next].prev = node.prev;
+        else tail = node.prev;
+    }
+
+    void pushFront(std::uint32_t n) {
+        nodes[n].prev = NONE;
+        nodes[n].next = head;
+        if (head != NONE) nodes[head].prev = n;
+        else tail = n;
+        head = n;
+    }
+
+    void moveToFront(std::uint32_t n) {
+        if (n == head) return;
+        unlink(n);
+        pushFront(n);
+    }
+
+    // Для ShardedLRUCache: поиск без изменения порядка (можно из нескольких потоков под
+    // разделяемой блокировкой) и отложенное продвижение по номеру элемента
+    template <typename, typename, typename> friend class ShardedLRUCache;
+
+    std::uint32_t findNode(const K& key) const { return index[findSlot(key, hashOf(key))].node; }
+
+    void promote(std::uint32_t n) {
+        if (n < used) moveToFront(n); //элемент мог уже достаться другому ключу - тогда продвинется он
+    }
+
+public:
+    explicit FixedLRUCache(std::size_t capacity, const Trace& trace = Trace())
+        : used(0), head(NONE), tail(NONE), trace(trace) {
+        if (capacity >= (std::size_t(1) << 30)) throw std::length_error("FixedLRUCache capacity must be below 2^30");
+        std::size_t indexSize = 2;
+        while (indexSize < 2 * capacity) indexSize *= 2;
+        nodes.resize(capacity);
+        index.assign(indexSize, Slot{ NONE, 0 });
+        mask = static_cast<std::uint32_t>(indexSize - 1);
+    }
+
+    FixedLRUCache(const FixedLRUCache&) = delete;
+    FixedLRUCache& operator=(const FixedLRUCache&) = delete;
+
+    std::size_t size() const { return used; }
+    std::size_t capacity() const { return nodes.size(); }
+    Trace& getTrace() { return trace; }
+
+    // Память под элементы и индекс - она выделена целиком в конструкторе
+    std::size_t getMemoryBytes() const { return nodes.capacity() * sizeof(Node) + index.capacity() * sizeof(Slot); }
+
+    bool get(const K& key, V& value) {
+        std::uint32_t slot = findSlot(key, hashOf(key));
+        if (index[slot].node == NONE) {
+            trace.onMiss(key);
+            return false;
+        }
+        std::uint32_t n = index[slot].node;
+        moveToFront(n);
+        value = nodes[n].value;
+        trace.onHit(key, nodes[n].value);
+        return true;
+    }
+
+    void put(const K& key, const V& value) {
+        if (nodes.empty()) return;
+        std::uint32_t hash = hashOf(key);
+        std::uint32_t slot = findSlot(key, hash);
+        if (index[slot].node != NONE) { //ключ уже был
+            std::uint32_t n = index[slot].node;
+            nodes[n].value = value;
+            moveToFront(n);
+            trace.onUpdate(key, value);
+            return;
+        }
+        std::uint32_t n;
+        if (used < nodes.size()) {
+            n = used++;
+        }
+        else { //кэш полон - элемент из хвоста переходит к новому ключу
+            n = tail;
+            unlink(n);
+            trace.onEvict(nodes[n].key, nodes[n].value);
+            const K& oldKey = nodes[n].key;
+            std::uint32_t oldSlot = findSlot(oldKey, hashOf(oldKey));
+            eraseSlot(oldSlot);
+            slot = findSlot(key, hash); //сдвиг мог сдвинуть и свободную ячейку для нового ключа
+        }
+        nodes[n].key = key;
+        nodes[n].value = value;
+        index[slot] = Slot{ n, hash };
+        pushFront(n);
+        trace.onInsert(key, value);
+    }
+
+    bool contains(const K& key) const { return index[findSlot(key, hashOf(key))].node != NONE; }
+
+    template <typename F>
+    void forEach(F f) const {
+        for (std::uint32_t n = head; n != NONE; n = nodes[n].next) f(nodes[n].key, nodes[n].value);
+    }
+
+    void clear() {
+        for (Slot& slot : index) slot.node = NONE;
+        used = 0;
+        head = tail = NONE;
+    }
+};
+
+// Кэш для нескольких потоков: ключи по хешу делятся на сегменты, у каждого сегмента свой
+// FixedLRUCache и своя блокировка, поэтому потоки с разными ключами друг друга не ждут.
+// Вытеснение идёт внутри сегмента - это приближение к общему LRU.
+// С deferredPromotion чтение берёт только разделяемую блокировку и не трогает список:
+// номер найденного элемента записывается в буфер чтений сегмента (свой для группы потоков),
+// а продвигает элементы тот, кто заполнил буфер и смог без ожидания взять монопольную
+// блокировку, или следующая запись в сегмент. Если буфер не успели разобрать, старые отметки
+// затираются - часть продвижений теряется, как в буферах чтения Caffeine. Без deferredPromotion
+// каждое чтение продвигает элемент сразу под монопольной блокировкой
+template <typename K, typename V, typename Hash = std::hash<K>>
+class ShardedLRUCache {
+private:
+    typedef FixedLRUCache<K, V, Hash> Cache;
+    static const std::size_t READ_BUFFER_SIZE = 32; //отметок в одном буфере
+    static const std::size_t READ_BUFFER_STRIPES = 4; //буферов на сегмент
+
+    struct ReadBuffer {
+        std::atomic<std::uint32_t> writes; //сколько отметок записано
+        std::uint32_t drained; //сколько из них разобрано; меняется под монопольной блокировкой
+        std::atomic<std::uint32_t> nodes[READ_BUFFER_SIZE];
+        char padding[64]; //счётчики соседних буферов - в разных строках кэша
+    };
+
+    struct Shard {
+        std::shared_timed_mutex lock;
+        Cache cache;
+        ReadBuffer buffers[READ_BUFFER_STRIPES];
+
+        explicit Shard(std::size_t capacity) : cache(capacity) {
+            for (ReadBuffer& buffer : buffers) {
+                buffer.writes.store(0);
+                buffer.drained = 0;
+                for (std::atomic<std::uint32_t>& node : buffer.nodes) node.store(Cache::NONE);
+            }
+        }
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::size_t shardMask;
+    bool deferredPromotion;
+    Hash hasher;
+
+    Shard& shardFor(const K& key) const {
+        return *shards[(lruMixHash(static_cast<std::uint64_t>(hasher(key))) >> 32) & shardMask]; //FixedLRUCache берёт младшие биты
+    }
+
+    static std::size_t threadStripe() {
+        static thread_local std::size_t stripe =
+            static_cast<std::size_t>(lruMixHash(std::hash<std::thread::id>()(std::this_thread::get_id())));
+        return stripe % READ_BUFFER_STRIPES;
+    }
+
+    // Разобрать отметки, записанные с прошлого разбора; вызывается под монопольной блокировкой.
+    // Отметка, которую читатель ещё не успел записать, теряется
+    static void drain(Shard& shard) {
+        for (ReadBuffer& buffer : shard.buffers) {
+            std::uint32_t end = buffer.writes.load(std::memory_order_acquire);
+            std::uint32_t start = end - buffer.drained > READ_BUFFER_SIZE ? end - (std::uint32_t)READ_BUFFER_SIZE : buffer.drained;
+            for (std::uint32_t position = start; position != end; position++) {
+                std::uint32_t n = buffer.nodes[position % READ_BUFFER_SIZE].load(std::memory_order_relaxed);
+                if (n != Cache::NONE) shard.cache.promote(n);
+            }
+            buffer.drained = end;
+        }
+    }
+
+    void recordRead(Shard& shard, std::uint32_t n) {
+        ReadBuffer& buffer = shard.buffers[threadStripe()];
+        std::uint32_t position = buffer.writes.fetch_add(1, std::memory_order_relaxed);
+        buffer.nodes[position % READ_BUFFER_SIZE].store(n, std::memory_order_relaxed);
+        if ((position + 1) % READ_BUFFER_SIZE == 0 && shard.lock.try_lock()) {
+            drain(shard);
+            shard.lock.unlock();
+        }
+    }
+
+public:
+    // capacity делится между shardCount сегментами (округляется до степени двойки, но не больше
+    // capacity): остаток достаётся первым сегментам по одному, так что сумма равна capacity
+    explicit ShardedLRUCache(std::size_t capacity, std::size_t shardCount = 64, bool deferredPromotion = true)
+        : deferredPromotion(deferredPromotion) {
+        std::size_t count = 1;
+        while (count < shardCount && count * 2 <= capacity) count *= 2;
+        shardMask = count - 1;
+        for (std::size_t i = 0; i < count; i++) {
+            shards.emplace_back(new Shard(capacity / count + (i < capacity % count ? 1 : 0)));
+        }
+    }
+
+    ShardedLRUCache(const ShardedLRUCache&) = delete;
+    ShardedLRUCache& operator=(const ShardedLRUCache&) = delete;
+
+    std::size_t shardCount() const { return shards.size(); }
+
+    std::size_t size() const {
+        std::size_t total = 0;
+        for (const std::unique_ptr<Shard>& shard : shards) {
+            std::shared_lock<std::shared_timed_mutex> guard(shard->lock);
+            total += shard->cache.size();
+        }
+        return total;
+    }
+
+    std::size_t capacity() const {
+        std::size_t total = 0;
+        for (const std::unique_ptr<Shard>& shard : shards) total += shard->cache.capacity();
+        return total;
+    }
+
+    bool get(const K& key, V& value) {
+        Shard& shard = shardFor(key);
+        if (!deferredPromotion) {
+            std::lock_guard<std::shared_timed_mutex> guard(shard.lock);
+            return shard.cache.get(key, value);
+        }
+        std::uint32_t n;
+        {
+            std::shared_lock<std::shared_timed_mutex> guard(shard.lock);
+            n = shard.cache.findNode(key);
+            if (n == Cache::NONE) return false;
+            value = shard.cache.nodes[n].value;
+        }
+        recordRead(shard, n);
+        return true;
+    }
+
+    void put(const K& key, const V& value) {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::shared_timed_mutex> guard(shard.lock);
+        if (deferredPromotion) drain(shard); //накопленные чтения учитываются до выбора жертвы
+        shard.cache.put(key, value);
+    }
+
+    bool contains(const K& key) const {
+        Shard& shard = shardFor(key);
+        std::shared_lock<std::shared_timed_mutex> guard(shard.lock);
+        return shard.cache.contains(key);
+    }
+};
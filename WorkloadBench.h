@@ -0,0 +1,62 @@
+#pragma once
+// Общие части замеров хеш-таблиц lr2n6 и кэшей lr2n7: генератор запросов с распределением
+// Ципфа и замер резидентной памяти процесса
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <random>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// Генератор рангов 0..n-1 с распределением Ципфа (метод Грея и др., как в YCSB): ранг 0 самый
+// частый. O(n) на подготовку, O(1) на число и без таблицы в памяти - подходит и для n = 10^8
+class ZipfGenerator {
+private:
+    int n;
+    double theta;
+    double zetaN;
+    double alpha;
+    double eta;
+    std::uniform_real_distribution<double> uniform;
+
+public:
+    ZipfGenerator(int n, double theta = 0.99) : n(n), theta(theta), uniform(0.0, 1.0) {
+        zetaN = 0;
+        for (int i = 1; i <= n; i++) zetaN += 1.0 / std::pow((double)i, theta);
+        double zeta2 = 1.0 + std::pow(0.5, theta);
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetaN);
+    }
+
+    int next(std::mt19937& gen) {
+        double u = uniform(gen);
+        double uz = u * zetaN;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + std::pow(0.5, theta)) return 1;
+        int rank = static_cast<int>(n * std::pow(eta * u - eta + 1.0, alpha));
+        return std::min(rank, n - 1);
+    }
+};
+
+// Резидентная память процесса в байтах (Linux, /proc/self/statm); 0 - если узнать нельзя
+inline size_t residentBytes() {
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    size_t totalPages = 0, residentPages = 0;
+    if (statm >> totalPages >> residentPages) return residentPages * (size_t)sysconf(_SC_PAGESIZE);
+#endif
+    return 0;
+}
+
+// Вернуть освобождённую память системе, чтобы прирост RSS следующего замера не маскировался
+// переиспользованием кучи после предыдущего
+inline void releaseFreeMemory() {
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+}
@@ -8,17 +8,25 @@
 #include <algorithm>
 #include <queue>
 #include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <cmath>
+#include "CompressionBench.h"
 
 using namespace std;
 
 struct HuffmanNode {
     char symbol;
-    int frequency;
+    uint64_t frequency;
     HuffmanNode* left;
     HuffmanNode* right;
 
-    HuffmanNode(char s, int freq) : symbol(s), frequency(freq), left(nullptr), right(nullptr) {}
-    HuffmanNode(int freq, HuffmanNode* l, HuffmanNode* r) : symbol('\0'), frequency(freq), left(l), right(r) {}
+    HuffmanNode(char s, uint64_t freq) : symbol(s), frequency(freq), left(nullptr), right(nullptr) {}
+    HuffmanNode(uint64_t freq, HuffmanNode* l, HuffmanNode* r) : symbol('\0'), frequency(freq), left(l), right(r) {}
 };
 
 // Компаратор для приоритетной очереди (минимальная частота first)
@@ -61,8 +69,8 @@ void printHuffmanTree(HuffmanNode* node, const string& prefix = "", bool isLeft
     cout << (isLeft ? "|--" : "|__");
 
     // Выводим информацию об узле
-    if (node->symbol == '\0') {
-        // Внутренний узел
+    if (node->left != nullptr || node->right != nullptr) {
+        // Внутренний узел (символ '\0' тоже может быть листом, поэтому смотрим на потомков)
         cout << "[" << node->frequency << "]";
     }
     else {
@@ -84,7 +92,7 @@ HuffmanNode* buildHuffmanTree(priority_queue<HuffmanNode*, vector<HuffmanNode*>,
         HuffmanNode* right = freeNodes.top();
         freeNodes.pop();
 
-        int parentFreq = left->frequency + right->frequency;
+        uint64_t parentFreq = left->frequency + right->frequency;
         HuffmanNode* parent = new HuffmanNode(parentFreq, left, right);
 
         freeNodes.push(parent);
@@ -93,10 +101,10 @@ HuffmanNode* buildHuffmanTree(priority_queue<HuffmanNode*, vector<HuffmanNode*>,
 }
 
 // Функция для генерации кодов Хаффмана
-void generateHuffmanCodes(HuffmanNode* root, const string& code = "", map<char, string>& codes = *new map<char, string>) {
+void generateHuffmanCodes(HuffmanNode* root, const string& code, map<char, string>& codes) {
     if (root == nullptr) return;
 
-    if (root->symbol != '\0') {
+    if (root->left == nullptr && root->right == nullptr) {
         codes[root->symbol] = code;
     }
     // Рекурсивно обходим левое и правое поддеревья
@@ -163,8 +171,1441 @@ string decodeString(const string& encoded, HuffmanNode* root) {
     return decoded;
 }
 
-int main() {
+// ------------------- Канонические коды Хаффмана -------------------
+
+const int MAX_CODE_LENGTH = 32;  // максимальная длина кода, которую держит битовый буфер
+const int DECODE_TABLE_BITS = 11; // сколько бит декодируем одним обращением к таблице
+// Ограничение длины кода при сжатии: все коды укладываются в одно обращение к таблице
+const int DEFAULT_MAX_CODE_LENGTH = DECODE_TABLE_BITS;
+
+// Канонический код: для каждого байта длина и сам код (старшие биты идут первыми)
+struct CanonicalCode {
+    uint8_t length[256];
+    uint32_t code[256];
+    int maxLength;
+
+    CanonicalCode() : maxLength(0) {
+        fill(begin(length), end(length), 0);
+        fill(begin(code), end(code), 0);
+    }
+};
+
+// Функция для получения длин кодов из дерева Хаффмана
+void getCodeLengths(HuffmanNode* node, uint8_t lengths[256], int depth = 0) {
+    if (node == nullptr) return;
+
+    if (node->left == nullptr && node->right == nullptr) {
+        // Единственный символ в дереве всё равно должен занимать хотя бы один бит
+        if (depth > MAX_CODE_LENGTH) {
+            throw runtime_error("Ошибка: длина кода Хаффмана больше 32 бит");
+        }
+        lengths[(unsigned char)node->symbol] = (uint8_t)max(depth, 1);
+        return;
+    }
+    getCodeLengths(node->left, lengths, depth + 1);
+    getCodeLengths(node->right, lengths, depth + 1);
+}
+
+// Узел дерева Хаффмана в плоском массиве: дети - индексы в том же массиве, у листьев -1
+struct FlatNode {
+    uint64_t frequency;
+    int left;
+    int right;
+    int symbol;
+    int depth;
+};
+
+// Функция для подсчёта частот в массив счётчиков (вместо map)
+void howOftenCounts(const uint8_t* data, size_t size, uint64_t counts[256]) {
+    for (size_t i = 0; i < size; i++) {
+        counts[data[i]]++;
+    }
+}
+
+// Функция для быстрого подсчёта частот байтов. Подряд идущие одинаковые байты
+// в одной таблице дают цепочку зависимых инкрементов одной ячейки, поэтому
+// байты раскладываются по 4 таблицам, а читаются по 8 за раз 64-битным словом.
+// Промежуточные счётчики 32-битные и сбрасываются в counts каждые HISTOGRAM_CHUNK байт.
+const size_t HISTOGRAM_CHUNK = (size_t)1 << 30;
+
+void histogram256(const uint8_t* data, size_t size, uint64_t counts[256]) {
+    uint32_t tables[4][256];
+    size_t pos = 0;
+    while (pos < size) {
+        size_t end = min(size, pos + HISTOGRAM_CHUNK);
+        memset(tables, 0, sizeof(tables));
+        for (; pos + 8 <= end; pos += 8) {
+            uint64_t word;
+            memcpy(&word, data + pos, 8);
+            tables[0][word & 0xFF]++;
+            tables[1][(word >> 8) & 0xFF]++;
+            tables[2][(word >> 16) & 0xFF]++;
+            tables[3][(word >> 24) & 0xFF]++;
+            tables[0][(word >> 32) & 0xFF]++;
+            tables[1][(word >> 40) & 0xFF]++;
+            tables[2][(word >> 48) & 0xFF]++;
+            tables[3][word >> 56]++;
+        }
+        for (; pos < end; pos++) {
+            tables[0][data[pos]]++;
+        }
+        for (int s = 0; s < 256; s++) {
+            counts[s] += (uint64_t)tables[0][s] + tables[1][s] + tables[2][s] + tables[3][s];
+        }
+    }
+}
+
+// Многопоточный вариант: каждый поток считает свой кусок в свою таблицу, потом суммируем
+void histogram256Parallel(const uint8_t* data, size_t size, uint64_t counts[256], size_t threads) {
+    const size_t MIN_PART = 1 << 20; // мелкие куски делить нет смысла
+    threads = max<size_t>(1, min(threads, size / MIN_PART));
+    if (threads == 1) {
+        histogram256(data, size, counts);
+        return;
+    }
+
+    vector<vector<uint64_t>> partial(threads, vector<uint64_t>(256, 0));
+    vector<thread> workers;
+    size_t part = size / threads;
+    for (size_t t = 0; t < threads; t++) {
+        size_t begin = t * part;
+        size_t length = t + 1 == threads ? size - begin : part;
+        workers.emplace_back([&partial, data, begin, length, t] {
+            histogram256(data + begin, length, partial[t].data());
+        });
+    }
+    for (thread& w : workers) w.join();
+    for (size_t t = 0; t < threads; t++) {
+        for (int s = 0; s < 256; s++) {
+            counts[s] += partial[t][s];
+        }
+    }
+}
+
+// Функция для построения дерева Хаффмана в одном массиве методом двух очередей:
+// листья сортируются по частоте, а внутренние узлы появляются уже в порядке
+// неубывания частот, поэтому минимум всегда в начале одной из двух очередей.
+// Первые leafCount элементов - листья, корень - последний элемент.
+vector<FlatNode> buildFlatHuffmanTree(const uint64_t* counts, size_t alphabetSize) {
+    size_t leafCount = 0;
+    for (size_t s = 0; s < alphabetSize; s++) {
+        if (counts[s] != 0) leafCount++;
+    }
+
+    vector<FlatNode> nodes;
+    if (leafCount == 0) return nodes;
+    nodes.reserve(2 * leafCount - 1); // единственное выделение памяти
+    for (size_t s = 0; s < alphabetSize; s++) {
+        if (counts[s] != 0) {
+            nodes.push_back({ counts[s], -1, -1, (int)s, 0 });
+        }
+    }
+    sort(nodes.begin(), nodes.end(), [](const FlatNode& a, const FlatNode& b) {
+        if (a.frequency == b.frequency) return a.symbol < b.symbol;
+        return a.frequency < b.frequency;
+        });
+
+    size_t nextLeaf = 0;
+    size_t nextInternal = leafCount;
+    auto takeMin = [&]() -> int {
+        // При равных частотах берём лист - так дерево получается ниже
+        if (nextLeaf < leafCount
+            && (nextInternal >= nodes.size() || nodes[nextLeaf].frequency <= nodes[nextInternal].frequency)) {
+            return (int)nextLeaf++;
+        }
+        return (int)nextInternal++;
+    };
+    while (nodes.size() < 2 * leafCount - 1) {
+        int left = takeMin();
+        int right = takeMin();
+        nodes.push_back({ nodes[left].frequency + nodes[right].frequency, left, right, -1, 0 });
+    }
+
+    // Родитель всегда правее детей, поэтому глубины считаются одним проходом от корня
+    for (size_t i = nodes.size(); i-- > leafCount;) {
+        nodes[nodes[i].left].depth = nodes[i].depth + 1;
+        nodes[nodes[i].right].depth = nodes[i].depth + 1;
+    }
+    return nodes;
+}
+
+// Функция для построения кодов с ограниченной длиной методом package-merge.
+// Уровень 0 - листья, отсортированные по частоте; каждый следующий уровень -
+// листья вместе с «пакетами» из соседних пар предыдущего уровня. Первые
+// 2n-2 элемента последнего уровня дают оптимальные длины: длина символа равна
+// числу выбранных элементов, в которые он входит.
+// maxLength - от 1 до MAX_CODE_LENGTH: более длинные коды не держат BitWriter и декодер
+void limitCodeLengths(const uint64_t counts[256], uint8_t lengths[256], int maxLength) {
+    struct Item {
+        uint64_t weight;
+        int symbol; // -1 у пакета
+        int first;  // у пакета - индекс первого из двух элементов предыдущего уровня
+    };
+
+    vector<Item> leaves;
+    for (int s = 0; s < 256; s++) {
+        if (counts[s] != 0) leaves.push_back({ counts[s], s, -1 });
+    }
+    sort(leaves.begin(), leaves.end(), [](const Item& a, const Item& b) {
+        if (a.weight == b.weight) return a.symbol < b.symbol;
+        return a.weight < b.weight;
+        });
+    fill(lengths, lengths + 256, 0);
+    size_t n = leaves.size();
+    if (n == 0) return;
+    if (n == 1) {
+        lengths[leaves[0].symbol] = 1;
+        return;
+    }
+    if (maxLength < 1 || maxLength > MAX_CODE_LENGTH) {
+        throw runtime_error("Ошибка: ограничение длины кода должно быть от 1 до "
+            + to_string(MAX_CODE_LENGTH) + " бит, задано " + to_string(maxLength));
+    }
+    if (((size_t)1 << maxLength) < n) {
+        throw runtime_error("Ошибка: " + to_string(n) + " символов не помещаются в коды длиной "
+            + to_string(maxLength) + " бит");
+    }
+
+    vector<vector<Item>> levels(maxLength);
+    levels[0] = leaves;
+    for (int level = 1; level < maxLength; level++) {
+        const vector<Item>& prev = levels[level - 1];
+        vector<Item>& current = levels[level];
+        current.reserve(n + prev.size() / 2);
+        size_t leaf = 0;
+        size_t pair = 0;
+        while (leaf < n || pair + 1 < prev.size()) {
+            bool takeLeaf = pair + 1 >= prev.size()
+                || (leaf < n && leaves[leaf].weight <= prev[pair].weight + prev[pair + 1].weight);
+            if (takeLeaf) {
+                current.push_back(leaves[leaf++]);
+            }
+            else {
+                current.push_back({ prev[pair].weight + prev[pair + 1].weight, -1, (int)pair });
+                pair += 2;
+            }
+        }
+    }
+
+    // Разворачиваем выбранные элементы сверху вниз
+    vector<char> selected(levels[maxLength - 1].size(), 0);
+    fill(selected.begin(), selected.begin() + (2 * n - 2), 1);
+    for (int level = maxLength - 1; level >= 0; level--) {
+        vector<char> below(level > 0 ? levels[level - 1].size() : 0, 0);
+        for (size_t i = 0; i < levels[level].size(); i++) {
+            if (!selected[i]) continue;
+            const Item& item = levels[level][i];
+            if (item.symbol >= 0) {
+                lengths[item.symbol]++;
+            }
+            else {
+                below[item.first] = 1;
+                below[item.first + 1] = 1;
+            }
+        }
+        selected.swap(below);
+    }
+}
+
+// Функция для получения длин кодов по таблице частот без дерева из указателей.
+// Если обычное дерево Хаффмана глубже maxLength, длины строятся package-merge
+void buildCodeLengths(const uint64_t counts[256], uint8_t lengths[256], int maxLength = DEFAULT_MAX_CODE_LENGTH) {
+    vector<FlatNode> nodes = buildFlatHuffmanTree(counts, 256);
+    fill(lengths, lengths + 256, 0);
+    for (const FlatNode& node : nodes) {
+        if (node.symbol < 0) break; // листья закончились
+        if (node.depth > maxLength) {
+            limitCodeLengths(counts, lengths, maxLength);
+            return;
+        }
+        lengths[node.symbol] = (uint8_t)max(node.depth, 1);
+    }
+}
+
+// Функция для проверки длин кодов, прочитанных из файла: каждая от 0 до MAX_CODE_LENGTH
+// и сумма 2^-длина не больше 1 (неравенство Крафта). Иначе коды не префиксные
+// и таблица декодирования выходит за свои границы
+bool validCodeLengths(const uint8_t lengths[256]) {
+    uint64_t kraft = 0; // сумма в единицах 2^-MAX_CODE_LENGTH
+    for (int s = 0; s < 256; s++) {
+        if (lengths[s] > MAX_CODE_LENGTH) return false;
+        if (lengths[s] != 0) kraft += 1ull << (MAX_CODE_LENGTH - lengths[s]);
+    }
+    return kraft <= (1ull << MAX_CODE_LENGTH);
+}
+
+// Функция для назначения канонических кодов по длинам
+// (символы упорядочены по длине, а при равной длине - по значению байта)
+CanonicalCode buildCanonicalCode(const uint8_t lengths[256]) {
+    CanonicalCode result;
+    int lengthCount[MAX_CODE_LENGTH + 1] = { 0 };
+    for (int s = 0; s < 256; s++) {
+        result.length[s] = lengths[s];
+        lengthCount[lengths[s]]++;
+        result.maxLength = max(result.maxLength, (int)lengths[s]);
+    }
+    lengthCount[0] = 0;
+
+    // Первый код каждой длины
+    uint32_t nextCode[MAX_CODE_LENGTH + 2] = { 0 };
+    uint32_t code = 0;
+    for (int len = 1; len <= MAX_CODE_LENGTH; len++) {
+        code = (code + lengthCount[len - 1]) << 1;
+        nextCode[len] = code;
+    }
+    for (int s = 0; s < 256; s++) {
+        if (result.length[s] != 0) {
+            result.code[s] = nextCode[result.length[s]]++;
+        }
+    }
+    return result;
+}
+
+// Запись битового потока через 64-битный буфер
+struct BitWriter {
+    vector<uint8_t>& out;
+    uint64_t buffer;
+    int bitCount; // сколько бит ещё не записано в out
+
+    BitWriter(vector<uint8_t>& output) : out(output), buffer(0), bitCount(0) {}
+
+    void put(uint32_t code, int length) {
+        buffer = (buffer << length) | code;
+        bitCount += length;
+        if (bitCount >= 32) {
+            bitCount -= 32;
+            uint32_t word = (uint32_t)(buffer >> bitCount);
+            out.push_back((uint8_t)(word >> 24));
+            out.push_back((uint8_t)(word >> 16));
+            out.push_back((uint8_t)(word >> 8));
+            out.push_back((uint8_t)word);
+        }
+    }
+
+    // Дописываем оставшиеся биты, дополняя последний байт нулями
+    void flush() {
+        while (bitCount >= 8) {
+            bitCount -= 8;
+            out.push_back((uint8_t)(buffer >> bitCount));
+        }
+        if (bitCount > 0) {
+            out.push_back((uint8_t)(buffer << (8 - bitCount)));
+            bitCount = 0;
+        }
+        buffer = 0;
+    }
+};
+
+// Чтение битового потока: биты выровнены по старшему разряду буфера.
+// Читает либо готовый массив, либо поток (кусками по STREAM_CHUNK_SIZE байт)
+const size_t STREAM_CHUNK_SIZE = 1 << 20;
+
+struct BitReader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    uint64_t buffer;
+    int bitCount;
+    istream* source;
+    vector<uint8_t> chunk;
+
+    BitReader(const uint8_t* d, size_t sz)
+        : data(d), size(sz), pos(0), buffer(0), bitCount(0), source(nullptr) {}
+    BitReader(istream& in)
+        : data(nullptr), size(0), pos(0), buffer(0), bitCount(0), source(&in), chunk(STREAM_CHUNK_SIZE) {}
+
+    // После refill в буфере не меньше 57 бит (за концом данных - нули)
+    void refill() {
+        while (bitCount <= 56) {
+            if (pos >= size && source != nullptr && *source) {
+                source->read((char*)chunk.data(), chunk.size());
+                data = chunk.data();
+                size = (size_t)source->gcount();
+                pos = 0;
+            }
+            uint64_t byte = pos < size ? data[pos] : 0;
+            pos++;
+            buffer |= byte << (56 - bitCount);
+            bitCount += 8;
+        }
+    }
+
+    uint32_t peek(int n) const { return (uint32_t)(buffer >> (64 - n)); }
+
+    void skip(int n) {
+        buffer <<= n;
+        bitCount -= n;
+    }
+};
+
+// Функция для кодирования строки каноническими кодами в настоящий битовый поток
+vector<uint8_t> encodeCanonical(const string& input, const CanonicalCode& cc) {
+    vector<uint8_t> encoded;
+    encoded.reserve(input.size() / 2 + 8);
+    BitWriter writer(encoded);
+    for (char ch : input) {
+        unsigned char s = (unsigned char)ch;
+        if (cc.length[s] == 0) {
+            throw runtime_error("Ошибка: символа нет в таблице кодов");
+        }
+        writer.put(cc.code[s], cc.length[s]);
+    }
+    writer.flush();
+    return encoded;
+}
+
+// Таблица для декодирования: короткие коды - одним обращением,
+// длинные - через первые коды каждой длины
+struct DecodeTable {
+    uint8_t symbol[1 << DECODE_TABLE_BITS];
+    uint8_t length[1 << DECODE_TABLE_BITS]; // 0 - код длиннее DECODE_TABLE_BITS
+    uint32_t firstCode[MAX_CODE_LENGTH + 1];
+    int firstIndex[MAX_CODE_LENGTH + 1];
+    int count[MAX_CODE_LENGTH + 1];
+    uint8_t sortedSymbols[256];
+    int maxLength;
+};
+
+DecodeTable buildDecodeTable(const CanonicalCode& cc) {
+    DecodeTable table;
+    fill(begin(table.symbol), end(table.symbol), 0);
+    fill(begin(table.length), end(table.length), 0);
+    fill(begin(table.count), end(table.count), 0);
+    table.maxLength = cc.maxLength;
+
+    for (int s = 0; s < 256; s++) {
+        table.count[cc.length[s]]++;
+    }
+    table.count[0] = 0;
+
+    int index = 0;
+    for (int len = 1; len <= MAX_CODE_LENGTH; len++) {
+        table.firstIndex[len] = index;
+        table.firstCode[len] = 0;
+        for (int s = 0; s < 256; s++) {
+            if (cc.length[s] == len) {
+                if (index == table.firstIndex[len]) table.firstCode[len] = cc.code[s];
+                table.sortedSymbols[index++] = (uint8_t)s;
+            }
+        }
+    }
+
+    // Заполняем таблицу для всех продолжений короткого кода
+    for (int s = 0; s < 256; s++) {
+        int len = cc.length[s];
+        if (len == 0 || len > DECODE_TABLE_BITS) continue;
+        uint32_t first = cc.code[s] << (DECODE_TABLE_BITS - len);
+        uint32_t last = first + (1u << (DECODE_TABLE_BITS - len));
+        for (uint32_t i = first; i < last; i++) {
+            table.symbol[i] = (uint8_t)s;
+            table.length[i] = (uint8_t)len;
+        }
+    }
+    return table;
+}
+
+// Функция для декодирования одного символа
+inline uint8_t decodeSymbol(BitReader& reader, const DecodeTable& table) {
+    reader.refill();
+    uint32_t index = reader.peek(DECODE_TABLE_BITS);
+    int len = table.length[index];
+    if (len != 0) {
+        reader.skip(len);
+        return table.symbol[index];
+    }
+
+    // Медленный путь для длинных кодов
+    uint32_t bits = reader.peek(MAX_CODE_LENGTH);
+    for (len = DECODE_TABLE_BITS + 1; len <= table.maxLength; len++) {
+        uint32_t code = bits >> (MAX_CODE_LENGTH - len);
+        if (code - table.firstCode[len] < (uint32_t)table.count[len]) {
+            reader.skip(len);
+            return table.sortedSymbols[table.firstIndex[len] + (code - table.firstCode[len])];
+        }
+    }
+    throw runtime_error("Ошибка: повреждённый поток Хаффмана");
+}
+
+// Функция для табличного декодирования count символов из битового потока
+string decodeCanonical(const vector<uint8_t>& encoded, size_t count, const CanonicalCode& cc) {
+    DecodeTable table = buildDecodeTable(cc);
+    string decoded(count, '\0');
+    BitReader reader(encoded.data(), encoded.size());
+
+    for (size_t i = 0; i < count; i++) {
+        decoded[i] = (char)decodeSymbol(reader, table);
+    }
+    return decoded;
+}
+
+// ------------------- Сжатие файлов -------------------
+//
+// Формат файла:
+//   "HUF5"                      - сигнатура
+//   версия          (1 байт)
+//   исходный размер (8 байт, little-endian)
+//   CRC-32 исходных данных (4 байта, little-endian)
+//   длины кодов для байтов 0..255 (256 байт, 0 - байт не встречается)
+//   битовый поток канонических кодов до конца файла
+
+const char FILE_MAGIC[4] = { 'H', 'U', 'F', '5' };
+const uint8_t FILE_VERSION = 1;
+const size_t FILE_BLOCK_SIZE = 1 << 20; // файл читается и пишется блоками по 1 МБ
+
+// Функция для подсчёта CRC-32 (полином 0xEDB88320), можно считать по частям
+// (таблица строится один раз, инициализация статической переменной потокобезопасна)
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t size) {
+    static const vector<uint32_t> table = [] {
+        vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void writeLE(ostream& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.put((char)(value >> (8 * i)));
+    }
+}
+
+uint64_t readLE(istream& in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        int byte = in.get();
+        if (byte == EOF) {
+            throw runtime_error("Ошибка: заголовок файла обрезан");
+        }
+        value |= (uint64_t)byte << (8 * i);
+    }
+    return value;
+}
+
+// Функция для сжатия файла: первый проход считает частоты и CRC, второй кодирует
+void compressFile(const string& inputPath, const string& outputPath) {
+    ifstream in(inputPath, ios::binary);
+    if (!in) {
+        throw runtime_error("Ошибка: не удалось открыть " + inputPath);
+    }
+
+    vector<uint8_t> block(FILE_BLOCK_SIZE);
+    uint64_t counts[256] = { 0 };
+    uint64_t originalSize = 0;
+    uint32_t crc = 0;
+    while (in) {
+        in.read((char*)block.data(), block.size());
+        size_t got = (size_t)in.gcount();
+        histogram256(block.data(), got, counts);
+        crc = crc32Update(crc, block.data(), got);
+        originalSize += got;
+    }
+
+    uint8_t codeLengths[256];
+    buildCodeLengths(counts, codeLengths);
+    CanonicalCode canonical = buildCanonicalCode(codeLengths);
+
+    ofstream out(outputPath, ios::binary);
+    if (!out) {
+        throw runtime_error("Ошибка: не удалось создать " + outputPath);
+    }
+    out.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+    out.put((char)FILE_VERSION);
+    writeLE(out, originalSize, 8);
+    writeLE(out, crc, 4);
+    out.write((const char*)codeLengths, 256);
+
+    // Второй проход: кодируем блоками, остаток бит переходит в следующий блок
+    in.clear();
+    in.seekg(0);
+    vector<uint8_t> encoded;
+    encoded.reserve(FILE_BLOCK_SIZE + 8);
+    BitWriter writer(encoded);
+    while (in) {
+        in.read((char*)block.data(), block.size());
+        size_t got = (size_t)in.gcount();
+        for (size_t i = 0; i < got; i++) {
+            writer.put(canonical.code[block[i]], canonical.length[block[i]]);
+        }
+        out.write((const char*)encoded.data(), encoded.size());
+        encoded.clear();
+    }
+    writer.flush();
+    out.write((const char*)encoded.data(), encoded.size());
+    if (!out) {
+        throw runtime_error("Ошибка записи в " + outputPath);
+    }
+}
+
+// Функция для распаковки файла с проверкой размера и CRC
+void decompressFile(const string& inputPath, const string& outputPath) {
+    ifstream in(inputPath, ios::binary);
+    if (!in) {
+        throw runtime_error("Ошибка: не удалось открыть " + inputPath);
+    }
+
+    char magic[4];
+    in.read(magic, sizeof(magic));
+    if (in.gcount() != sizeof(magic) || !equal(magic, magic + 4, FILE_MAGIC)) {
+        throw runtime_error("Ошибка: это не файл, сжатый lr2n5");
+    }
+    uint8_t version = (uint8_t)readLE(in, 1);
+    if (version != FILE_VERSION) {
+        throw runtime_error("Ошибка: неподдерживаемая версия формата " + to_string(version));
+    }
+    uint64_t originalSize = readLE(in, 8);
+    uint32_t expectedCrc = (uint32_t)readLE(in, 4);
+    uint8_t codeLengths[256];
+    in.read((char*)codeLengths, 256);
+    if (in.gcount() != 256) {
+        throw runtime_error("Ошибка: заголовок файла обрезан");
+    }
+    if (!validCodeLengths(codeLengths)) {
+        throw runtime_error("Ошибка: заголовок файла повреждён (недопустимые длины кодов)");
+    }
+
+    CanonicalCode canonical = buildCanonicalCode(codeLengths);
+    DecodeTable table = buildDecodeTable(canonical);
+    ofstream out(outputPath, ios::binary);
+    if (!out) {
+        throw runtime_error("Ошибка: не удалось создать " + outputPath);
+    }
+
+    BitReader reader(in);
+    vector<uint8_t> block(FILE_BLOCK_SIZE);
+    uint64_t remaining = originalSize;
+    uint32_t crc = 0;
+    while (remaining > 0) {
+        size_t n = (size_t)min<uint64_t>(remaining, block.size());
+        for (size_t i = 0; i < n; i++) {
+            block[i] = decodeSymbol(reader, table);
+        }
+        crc = crc32Update(crc, block.data(), n);
+        out.write((const char*)block.data(), n);
+        remaining -= n;
+    }
+    if (crc != expectedCrc) {
+        throw runtime_error("Ошибка: контрольная сумма не совпадает, данные повреждены");
+    }
+    if (!out) {
+        throw runtime_error("Ошибка записи в " + outputPath);
+    }
+}
+
+// ------------------- Блочное параллельное сжатие -------------------
+//
+// Формат файла:
+//   "HUB5", версия (1 байт), размер блока (4 байта), исходный размер (8 байт)
+//   сжатые блоки подряд; каждый блок самостоятельный:
+//     метод 1 - 256 длин кодов + битовый поток, метод 0 - байты как есть
+//   индекс блоков: для каждого блока смещение (8), сжатый размер (4),
+//     исходный размер (4), CRC-32 (4), метод (1)
+//   число блоков (8) и смещение индекса (8) - последние 16 байт файла
+//
+// Благодаря индексу любой блок можно распаковать отдельно.
+
+const char BLOCK_FILE_MAGIC[4] = { 'H', 'U', 'B', '5' };
+const uint8_t BLOCK_FILE_VERSION = 1;
+const size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+const size_t BLOCK_INDEX_ENTRY_SIZE = 21;
+const size_t BLOCK_HEADER_SIZE = 17;  // сигнатура, версия, размер блока, исходный размер
+const size_t BLOCK_TRAILER_SIZE = 16; // число блоков и смещение индекса
+
+struct BlockInfo {
+    uint64_t offset;
+    uint32_t compressedSize;
+    uint32_t rawSize;
+    uint32_t crc;
+    uint8_t method; // 0 - без сжатия, 1 - канонический Хаффман
+};
+
+// Пул потоков с общей очередью задач
+class ThreadPool {
+private:
+    vector<thread> workers;
+    queue<function<void()>> tasks;
+    mutex m;
+    condition_variable taskReady;
+    condition_variable allDone;
+    size_t active;
+    bool stopping;
+
+    void workerLoop() {
+        while (true) {
+            function<void()> task;
+            {
+                unique_lock<mutex> lock(m);
+                taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) return;
+                task = move(tasks.front());
+                tasks.pop();
+                active++;
+            }
+            task();
+            {
+                lock_guard<mutex> lock(m);
+                active--;
+                if (active == 0 && tasks.empty()) allDone.notify_all();
+            }
+        }
+    }
+
+public:
+    ThreadPool(size_t threads) : active(0), stopping(false) {
+        if (threads == 0) threads = 1;
+        for (size_t i = 0; i < threads; i++) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+        }
+        taskReady.notify_all();
+        for (thread& t : workers) t.join();
+    }
+
+    void submit(function<void()> task) {
+        {
+            lock_guard<mutex> lock(m);
+            tasks.push(move(task));
+        }
+        taskReady.notify_one();
+    }
+
+    // Ждём, пока все поставленные задачи выполнятся
+    void wait() {
+        unique_lock<mutex> lock(m);
+        allDone.wait(lock, [this] { return active == 0 && tasks.empty(); });
+    }
+
+    size_t size() const { return workers.size(); }
+};
+
+// Функция для сжатия одного блока со своей таблицей кодов
+vector<uint8_t> compressBlock(const uint8_t* data, size_t size, BlockInfo& info) {
+    uint64_t counts[256] = { 0 };
+    histogram256(data, size, counts);
+
+    uint8_t codeLengths[256];
+    buildCodeLengths(counts, codeLengths);
+    CanonicalCode canonical = buildCanonicalCode(codeLengths);
+
+    vector<uint8_t> result(codeLengths, codeLengths + 256);
+    result.reserve(256 + size / 2);
+    BitWriter writer(result);
+    for (size_t i = 0; i < size; i++) {
+        writer.put(canonical.code[data[i]], canonical.length[data[i]]);
+    }
+    writer.flush();
+
+    info.rawSize = (uint32_t)size;
+    info.crc = crc32Update(0, data, size);
+    info.method = 1;
+    if (result.size() >= size) {
+        // Несжимаемый блок храним как есть
+        result.assign(data, data + size);
+        info.method = 0;
+    }
+    info.compressedSize = (uint32_t)result.size();
+    return result;
+}
+
+// Функция для распаковки одного блока в out (out должен вмещать info.rawSize байт)
+void decompressBlock(const uint8_t* data, const BlockInfo& info, uint8_t* out) {
+    if (info.method == 0) {
+        if (info.compressedSize != info.rawSize) {
+            throw runtime_error("Ошибка: повреждён индекс блоков");
+        }
+        copy(data, data + info.rawSize, out);
+    }
+    else if (info.method == 1) {
+        if (info.compressedSize < 256) {
+            throw runtime_error("Ошибка: повреждён индекс блоков");
+        }
+        if (!validCodeLengths(data)) {
+            throw runtime_error("Ошибка: блок повреждён (недопустимые длины кодов)");
+        }
+        CanonicalCode canonical = buildCanonicalCode(data);
+        DecodeTable table = buildDecodeTable(canonical);
+        BitReader reader(data + 256, info.compressedSize - 256);
+        for (uint32_t i = 0; i < info.rawSize; i++) {
+            out[i] = decodeSymbol(reader, table);
+        }
+    }
+    else {
+        throw runtime_error("Ошибка: повреждён индекс блоков (неизвестный способ сжатия блока)");
+    }
+    if (crc32Update(0, out, info.rawSize) != info.crc) {
+        throw runtime_error("Ошибка: контрольная сумма блока не совпадает");
+    }
+}
+
+// Функция для блочного сжатия: блоки читаются пачками по 2 на поток,
+// сжимаются параллельно и записываются по порядку
+void compressFileBlocks(const string& inputPath, const string& outputPath, size_t threads,
+    size_t blockSize = DEFAULT_BLOCK_SIZE) {
+    ifstream in(inputPath, ios::binary);
+    if (!in) {
+        throw runtime_error("Ошибка: не удалось открыть " + inputPath);
+    }
+    ofstream out(outputPath, ios::binary);
+    if (!out) {
+        throw runtime_error("Ошибка: не удалось создать " + outputPath);
+    }
+
+    out.write(BLOCK_FILE_MAGIC, sizeof(BLOCK_FILE_MAGIC));
+    out.put((char)BLOCK_FILE_VERSION);
+    writeLE(out, blockSize, 4);
+    streampos sizePos = out.tellp();
+    writeLE(out, 0, 8); // исходный размер допишем в конце
+
+    ThreadPool pool(threads);
+    size_t batch = pool.size() * 2;
+    vector<vector<uint8_t>> raw(batch, vector<uint8_t>(blockSize));
+    vector<vector<uint8_t>> packed(batch);
+    vector<string> errors(batch);
+    vector<BlockInfo> index;
+    uint64_t offset = out.tellp();
+    uint64_t originalSize = 0;
+
+    while (in) {
+        size_t filled = 0;
+        vector<BlockInfo> infos(batch);
+        for (; filled < batch && in; filled++) {
+            in.read((char*)raw[filled].data(), blockSize);
+            size_t got = (size_t)in.gcount();
+            if (got == 0) break;
+            raw[filled].resize(got);
+            errors[filled].clear();
+        }
+        for (size_t b = 0; b < filled; b++) {
+            pool.submit([&, b] {
+                // Исключение не должно выйти из потока пула - передаём его основному потоку
+                try {
+                    packed[b] = compressBlock(raw[b].data(), raw[b].size(), infos[b]);
+                }
+                catch (const exception& e) {
+                    errors[b] = e.what();
+                }
+            });
+        }
+        pool.wait();
+
+        for (size_t b = 0; b < filled; b++) {
+            if (!errors[b].empty()) {
+                throw runtime_error(errors[b] + " (блок " + to_string(index.size()) + ")");
+            }
+            infos[b].offset = offset;
+            out.write((const char*)packed[b].data(), packed[b].size());
+            offset += packed[b].size();
+            originalSize += raw[b].size();
+            index.push_back(infos[b]);
+            raw[b].resize(blockSize);
+        }
+    }
+
+    uint64_t indexOffset = offset;
+    for (const BlockInfo& info : index) {
+        writeLE(out, info.offset, 8);
+        writeLE(out, info.compressedSize, 4);
+        writeLE(out, info.rawSize, 4);
+        writeLE(out, info.crc, 4);
+        writeLE(out, info.method, 1);
+    }
+    writeLE(out, index.size(), 8);
+    writeLE(out, indexOffset, 8);
+    out.seekp(sizePos);
+    writeLE(out, originalSize, 8);
+    if (!out) {
+        throw runtime_error("Ошибка записи в " + outputPath);
+    }
+}
+
+// Функция для чтения заголовка и индекса блочного файла
+vector<BlockInfo> readBlockIndex(istream& in, uint64_t& originalSize) {
+    char magic[4];
+    in.read(magic, sizeof(magic));
+    if (in.gcount() != sizeof(magic) || !equal(magic, magic + 4, BLOCK_FILE_MAGIC)) {
+        throw runtime_error("Ошибка: это не блочный файл lr2n5");
+    }
+    uint8_t version = (uint8_t)readLE(in, 1);
+    if (version != BLOCK_FILE_VERSION) {
+        throw runtime_error("Ошибка: неподдерживаемая версия формата " + to_string(version));
+    }
+    uint64_t blockSize = readLE(in, 4);
+    originalSize = readLE(in, 8);
+
+    // Все размеры из индекса сверяем с длиной файла до того, как по ним что-то выделять
+    in.seekg(0, ios::end);
+    uint64_t fileSize = (uint64_t)in.tellg();
+    if (fileSize < BLOCK_HEADER_SIZE + BLOCK_TRAILER_SIZE) {
+        throw runtime_error("Ошибка: блочный файл обрезан");
+    }
+    in.seekg(-(streamoff)BLOCK_TRAILER_SIZE, ios::end);
+    uint64_t blockCount = readLE(in, 8);
+    uint64_t indexOffset = readLE(in, 8);
+    uint64_t maxBlocks = (fileSize - BLOCK_HEADER_SIZE - BLOCK_TRAILER_SIZE) / BLOCK_INDEX_ENTRY_SIZE;
+    if (blockCount > maxBlocks || indexOffset < BLOCK_HEADER_SIZE
+        || indexOffset != fileSize - BLOCK_TRAILER_SIZE - blockCount * BLOCK_INDEX_ENTRY_SIZE) {
+        throw runtime_error("Ошибка: повреждён индекс блоков (не сходится с длиной файла)");
+    }
+    in.seekg(indexOffset);
+
+    vector<BlockInfo> index(blockCount);
+    uint64_t total = 0;
+    for (BlockInfo& info : index) {
+        info.offset = readLE(in, 8);
+        info.compressedSize = (uint32_t)readLE(in, 4);
+        info.rawSize = (uint32_t)readLE(in, 4);
+        info.crc = (uint32_t)readLE(in, 4);
+        info.method = (uint8_t)readLE(in, 1);
+        // Блок лежит между заголовком и индексом; исходный размер не больше размера блока
+        // и не больше, чем можно закодировать сжатыми байтами (минимум 1 бит на символ)
+        bool inside = info.offset >= BLOCK_HEADER_SIZE && info.offset <= indexOffset
+            && info.compressedSize <= indexOffset - info.offset;
+        bool rawFits = info.rawSize <= blockSize && (info.method == 0
+            ? info.rawSize == info.compressedSize
+            : info.compressedSize >= 256 && info.rawSize <= 8 * (uint64_t)(info.compressedSize - 256));
+        if (!inside || !rawFits || info.method > 1) {
+            throw runtime_error("Ошибка: повреждён индекс блоков");
+        }
+        total += info.rawSize;
+    }
+    if (total != originalSize) {
+        throw runtime_error("Ошибка: размер по индексу не совпадает с заголовком");
+    }
+    return index;
+}
+
+// Функция для параллельной распаковки блочного файла
+void decompressFileBlocks(const string& inputPath, const string& outputPath, size_t threads) {
+    ifstream in(inputPath, ios::binary);
+    if (!in) {
+        throw runtime_error("Ошибка: не удалось открыть " + inputPath);
+    }
+    uint64_t originalSize;
+    vector<BlockInfo> index = readBlockIndex(in, originalSize);
+
+    ofstream out(outputPath, ios::binary);
+    if (!out) {
+        throw runtime_error("Ошибка: не удалось создать " + outputPath);
+    }
+
+    ThreadPool pool(threads);
+    size_t batch = pool.size() * 2;
+    vector<vector<uint8_t>> packed(batch);
+    vector<vector<uint8_t>> raw(batch);
+    vector<string> errors(batch);
+
+    for (size_t first = 0; first < index.size(); first += batch) {
+        size_t filled = min(batch, index.size() - first);
+        for (size_t b = 0; b < filled; b++) {
+            const BlockInfo& info = index[first + b];
+            packed[b].resize(info.compressedSize);
+            in.seekg(info.offset);
+            in.read((char*)packed[b].data(), info.compressedSize);
+            raw[b].resize(info.rawSize);
+            errors[b].clear();
+        }
+        for (size_t b = 0; b < filled; b++) {
+            pool.submit([&, b, first] {
+                try {
+                    decompressBlock(packed[b].data(), index[first + b], raw[b].data());
+                }
+                catch (const exception& e) {
+                    errors[b] = e.what();
+                }
+            });
+        }
+        pool.wait();
+
+        for (size_t b = 0; b < filled; b++) {
+            if (!errors[b].empty()) {
+                throw runtime_error(errors[b] + " (блок " + to_string(first + b) + ")");
+            }
+            out.write((const char*)raw[b].data(), raw[b].size());
+        }
+    }
+    if (!out) {
+        throw runtime_error("Ошибка записи в " + outputPath);
+    }
+}
+
+// Функция для распаковки одного блока по номеру (произвольный доступ)
+void extractBlock(const string& inputPath, size_t blockNumber, const string& outputPath) {
+    ifstream in(inputPath, ios::binary);
+    if (!in) {
+        throw runtime_error("Ошибка: не удалось открыть " + inputPath);
+    }
+    uint64_t originalSize;
+    vector<BlockInfo> index = readBlockIndex(in, originalSize);
+    if (blockNumber >= index.size()) {
+        throw runtime_error("Ошибка: в файле всего " + to_string(index.size()) + " блоков");
+    }
+
+    const BlockInfo& info = index[blockNumber];
+    vector<uint8_t> packed(info.compressedSize);
+    in.seekg(info.offset);
+    in.read((char*)packed.data(), info.compressedSize);
+    vector<uint8_t> raw(info.rawSize);
+    decompressBlock(packed.data(), info, raw.data());
+
+    ofstream out(outputPath, ios::binary);
+    out.write((const char*)raw.data(), raw.size());
+    if (!out) {
+        throw runtime_error("Ошибка записи в " + outputPath);
+    }
+}
+
+// ------------------- Адаптивное потоковое сжатие -------------------
+//
+// Частоты заранее не известны: кодер и декодер начинают с одинаковой модели
+// (все 256 байтов с частотой 1) и после каждого блока обновляют её по только
+// что обработанным данным. Поэтому хватает одного прохода, и вход может быть
+// каналом (pipe) или сокетом. Каждый блок дописывается в выход сразу.
+//
+// Формат потока:
+//   "HUA5", версия (1 байт)
+//   блоки: число байтов в блоке (4), размер битового потока (4), CRC-32 блока (4),
+//          битовый поток блока (дополнен нулями до целого байта)
+//   блок с числом байтов 0 - конец потока
+// Все числа - little-endian.
+
+const char ADAPTIVE_MAGIC[4] = { 'H', 'U', 'A', '5' };
+const uint8_t ADAPTIVE_VERSION = 1;
+const size_t ADAPTIVE_FIRST_BLOCK = 1 << 12; // первые блоки маленькие, чтобы модель быстрее обучилась
+const size_t ADAPTIVE_BLOCK_SIZE = 1 << 16;  // задержка - не больше одного блока
+const uint64_t ADAPTIVE_AGING_LIMIT = 1 << 18; // при большей сумме частоты делятся пополам
+
+// Модель, которую кодер и декодер обновляют одинаково
+struct AdaptiveModel {
+    uint64_t counts[256];
+    uint64_t total;
+    CanonicalCode code;
+
+    AdaptiveModel() : total(256) {
+        fill(begin(counts), end(counts), 1);
+        rebuild();
+    }
+
+    void rebuild() {
+        uint8_t lengths[256];
+        buildCodeLengths(counts, lengths);
+        code = buildCanonicalCode(lengths);
+    }
+
+    // Учитываем очередной блок; старые данные постепенно «забываются»,
+    // чтобы модель успевала за изменением входа
+    void update(const uint8_t* data, size_t size) {
+        histogram256(data, size, counts);
+        total += size;
+        while (total > ADAPTIVE_AGING_LIMIT) {
+            total = 0;
+            for (int s = 0; s < 256; s++) {
+                counts[s] = (counts[s] + 1) / 2; // ненулевые частоты остаются ненулевыми
+                total += counts[s];
+            }
+        }
+        rebuild();
+    }
+};
+
+// Открывает файл или возвращает стандартный поток для пути "-"
+istream& openInput(const string& path, ifstream& file) {
+    if (path == "-") return cin;
+    file.open(path, ios::binary);
+    if (!file) {
+        throw runtime_error("Ошибка: не удалось открыть " + path);
+    }
+    return file;
+}
+
+ostream& openOutput(const string& path, ofstream& file) {
+    if (path == "-") return cout;
+    file.open(path, ios::binary);
+    if (!file) {
+        throw runtime_error("Ошибка: не удалось создать " + path);
+    }
+    return file;
+}
+
+// Функция для адаптивного сжатия за один проход
+void compressAdaptive(const string& inputPath, const string& outputPath) {
+    ifstream inFile;
+    ofstream outFile;
+    istream& in = openInput(inputPath, inFile);
+    ostream& out = openOutput(outputPath, outFile);
+
+    out.write(ADAPTIVE_MAGIC, sizeof(ADAPTIVE_MAGIC));
+    out.put((char)ADAPTIVE_VERSION);
+
+    AdaptiveModel model;
+    vector<uint8_t> block(ADAPTIVE_BLOCK_SIZE);
+    vector<uint8_t> encoded;
+    encoded.reserve(ADAPTIVE_BLOCK_SIZE * 2);
+    size_t blockSize = ADAPTIVE_FIRST_BLOCK;
+    while (in) {
+        in.read((char*)block.data(), blockSize);
+        size_t got = (size_t)in.gcount();
+        if (got == 0) break;
+        blockSize = min(blockSize * 2, ADAPTIVE_BLOCK_SIZE);
+
+        encoded.clear();
+        BitWriter writer(encoded);
+        for (size_t i = 0; i < got; i++) {
+            writer.put(model.code.code[block[i]], model.code.length[block[i]]);
+        }
+        writer.flush();
+
+        writeLE(out, got, 4);
+        writeLE(out, encoded.size(), 4);
+        writeLE(out, crc32Update(0, block.data(), got), 4);
+        out.write((const char*)encoded.data(), encoded.size());
+        out.flush();
+
+        model.update(block.data(), got);
+    }
+    writeLE(out, 0, 4);
+    out.flush();
+    if (!out) {
+        throw runtime_error("Ошибка записи в " + outputPath);
+    }
+}
+
+// Функция для адаптивной распаковки: модель повторяет действия кодера
+void decompressAdaptive(const string& inputPath, const string& outputPath) {
+    ifstream inFile;
+    ofstream outFile;
+    istream& in = openInput(inputPath, inFile);
+    ostream& out = openOutput(outputPath, outFile);
+
+    char magic[4];
+    in.read(magic, sizeof(magic));
+    if (in.gcount() != sizeof(magic) || !equal(magic, magic + 4, ADAPTIVE_MAGIC)) {
+        throw runtime_error("Ошибка: это не адаптивный поток lr2n5");
+    }
+    uint8_t version = (uint8_t)readLE(in, 1);
+    if (version != ADAPTIVE_VERSION) {
+        throw runtime_error("Ошибка: неподдерживаемая версия формата " + to_string(version));
+    }
+
+    AdaptiveModel model;
+    DecodeTable table = buildDecodeTable(model.code);
+    vector<uint8_t> encoded;
+    vector<uint8_t> block;
+    while (true) {
+        uint32_t rawSize = (uint32_t)readLE(in, 4);
+        if (rawSize == 0) break;
+        uint32_t encodedSize = (uint32_t)readLE(in, 4);
+        uint32_t crc = (uint32_t)readLE(in, 4);
+        if (rawSize > ADAPTIVE_BLOCK_SIZE || encodedSize > ADAPTIVE_BLOCK_SIZE * 4 + 8) {
+            throw runtime_error("Ошибка: повреждён заголовок блока");
+        }
+        encoded.resize(encodedSize);
+        in.read((char*)encoded.data(), encodedSize);
+        if ((uint32_t)in.gcount() != encodedSize) {
+            throw runtime_error("Ошибка: поток обрезан");
+        }
+
+        block.resize(rawSize);
+        BitReader reader(encoded.data(), encoded.size());
+        for (uint32_t i = 0; i < rawSize; i++) {
+            block[i] = decodeSymbol(reader, table);
+        }
+        if (crc32Update(0, block.data(), rawSize) != crc) {
+            throw runtime_error("Ошибка: контрольная сумма блока не совпадает");
+        }
+        out.write((const char*)block.data(), rawSize);
+        out.flush();
+
+        model.update(block.data(), rawSize);
+        table = buildDecodeTable(model.code);
+    }
+    if (!out) {
+        throw runtime_error("Ошибка записи в " + outputPath);
+    }
+}
+
+// ------------------- Замеры скорости подсчёта частот -------------------
+
+// Функция для замера одного способа подсчёта: возвращает МБ/с (лучший из нескольких запусков)
+double measureThroughput(size_t bytes, const function<void()>& run, int repeats = 3) {
+    double best = 0;
+    for (int r = 0; r < repeats; r++) {
+        auto start = chrono::steady_clock::now();
+        run();
+        auto end = chrono::steady_clock::now();
+        double seconds = chrono::duration<double>(end - start).count();
+        best = max(best, bytes / 1e6 / max(seconds, 1e-9));
+    }
+    return best;
+}
+
+// Сравнение howOften (map), howOftenCounts, histogram256 и его многопоточной версии
+void benchmarkHistogram(size_t megabytes) {
+    size_t size = megabytes << 20;
+    mt19937 gen(12345);
+    // Текстоподобные данные (геометрическое распределение) и худший случай - один байт
+    geometric_distribution<int> skewed(0.08);
+    string text(size, '\0');
+    for (char& c : text) c = (char)(' ' + min(skewed(gen), 94));
+    string same(size, 'a');
+
+    size_t threads = max(1u, thread::hardware_concurrency());
+    cout << "Подсчёт частот, " << megabytes << " МБ, потоков: " << threads << endl;
+    cout << "Способ                      текст, МБ/с   один байт, МБ/с" << endl;
+    vector<pair<string, function<void(const string&)>>> methods = {
+        { "howOften (map)            ", [](const string& d) { volatile size_t n = howOften(d).size(); (void)n; } },
+        { "howOftenCounts            ", [](const string& d) {
+            uint64_t c[256] = { 0 }; howOftenCounts((const uint8_t*)d.data(), d.size(), c); volatile uint64_t x = c[0]; (void)x; } },
+        { "histogram256              ", [](const string& d) {
+            uint64_t c[256] = { 0 }; histogram256((const uint8_t*)d.data(), d.size(), c); volatile uint64_t x = c[0]; (void)x; } },
+        { "histogram256Parallel      ", [threads](const string& d) {
+            uint64_t c[256] = { 0 }; histogram256Parallel((const uint8_t*)d.data(), d.size(), c, threads); volatile uint64_t x = c[0]; (void)x; } },
+    };
+    for (const auto& method : methods) {
+        double textSpeed = measureThroughput(size, [&] { method.second(text); });
+        double sameSpeed = measureThroughput(size, [&] { method.second(same); });
+        cout << method.first << "  " << fixed;
+        cout.precision(1);
+        cout.width(12);
+        cout << textSpeed << "   ";
+        cout.width(15);
+        cout << sameSpeed << endl;
+    }
+
+    // Проверяем, что все способы дают одно и то же
+    uint64_t a[256] = { 0 }, b[256] = { 0 };
+    howOftenCounts((const uint8_t*)text.data(), size, a);
+    histogram256Parallel((const uint8_t*)text.data(), size, b, threads);
+    cout << (equal(a, a + 256, b) ? "Результаты совпадают" : "Ошибка: результаты различаются!") << endl;
+}
+
+// ------------------- Цена ограничения длины кода -------------------
+
+// Функция для сравнения размера сжатых данных при разных ограничениях длины кода
+void benchmarkLengthLimit(const vector<string>& paths) {
+    const vector<int> limits = { MAX_CODE_LENGTH, 16, 15, 14, 13, 12, 11, 10, 9 };
+    for (const string& path : paths) {
+        ifstream in(path, ios::binary);
+        if (!in) {
+            throw runtime_error("Ошибка: не удалось открыть " + path);
+        }
+        vector<uint8_t> block(FILE_BLOCK_SIZE);
+        uint64_t counts[256] = { 0 };
+        uint64_t total = 0;
+        while (in) {
+            in.read((char*)block.data(), block.size());
+            size_t got = (size_t)in.gcount();
+            histogram256(block.data(), got, counts);
+            total += got;
+        }
+
+        double entropyBits = 0;
+        for (int s = 0; s < 256; s++) {
+            if (counts[s] == 0) continue;
+            double p = (double)counts[s] / total;
+            entropyBits -= counts[s] * log2(p);
+        }
+        cout << path << ": " << total << " байт, энтропийная граница " << (uint64_t)(entropyBits / 8) << " байт" << endl;
+        cout << "  Макс. длина   Размер, байт   Потеря, %" << endl;
+
+        uint64_t baseBits = 0; //при ограничении MAX_CODE_LENGTH: обычный Хаффман, если дерево не глубже
+        for (int limit : limits) {
+            uint8_t lengths[256];
+            buildCodeLengths(counts, lengths, limit);
+            uint64_t bits = 0;
+            int longest = 0;
+            for (int s = 0; s < 256; s++) {
+                bits += counts[s] * lengths[s];
+                longest = max(longest, (int)lengths[s]);
+            }
+            if (limit == MAX_CODE_LENGTH) baseBits = bits;
+            double loss = baseBits ? 100.0 * ((double)bits - baseBits) / baseBits : 0;
+            cout << "  ";
+            cout.width(11);
+            cout << (limit == MAX_CODE_LENGTH ? to_string(limit) + " (" + to_string(longest) + ")" : to_string(limit));
+            cout << "   ";
+            cout.width(12);
+            cout << (bits + 7) / 8 << "   " << fixed;
+            cout.precision(3);
+            cout << loss << endl;
+        }
+    }
+}
+
+// ------------------- Общий замер сжатия -------------------
+
+// Функция для замера обоих построителей и кодеков на всех наборах данных.
+// Результат печатается таблицей, а при заданном jsonPath ещё и пишется в JSON
+void benchmarkCompression(size_t megabytes, const string& jsonPath) {
+    const size_t LEGACY_LIMIT = 1 << 20; // строковый кодер медленный - гоняем его на первом мегабайте
+    size_t size = megabytes << 20;
+    string json = "{\n  \"program\": \"lr2n5\",\n  \"corpus_bytes\": " + to_string(size) + ",\n  \"results\": [\n";
+
+    cout << "Набор       Энтропия,Б   Сжато,Б  Дерево,мкс  Плоское,мкс  Строки кодир/декод,МБ/с  Канон. кодир/декод,МБ/с" << endl;
+    for (size_t c = 0; c < CORPUS_NAMES.size(); c++) {
+        const string& name = CORPUS_NAMES[c];
+        string corpus = generateCorpus(name, size);
+        const uint8_t* bytes = (const uint8_t*)corpus.data();
+
+        // Построение кодов: дерево из указателей и плоский массив
+        map<char, string> huffmanCodes;
+        HuffmanNode* huffmanTree = nullptr;
+        double pointerBuild = measureMicroseconds([&] {
+            map<char, int> frequency = howOften(corpus);
+            auto freeNodes = createFreeNodesList(frequency);
+            huffmanTree = buildHuffmanTree(freeNodes);
+            generateHuffmanCodes(huffmanTree, "", huffmanCodes);
+            });
+        uint64_t counts[256] = { 0 };
+        CanonicalCode canonical;
+        double flatBuild = measureMicroseconds([&] {
+            histogram256(bytes, corpus.size(), counts);
+            uint8_t lengths[256];
+            buildCodeLengths(counts, lengths);
+            canonical = buildCanonicalCode(lengths);
+            });
+
+        double entropyBits = 0;
+        for (int s = 0; s < 256; s++) {
+            if (counts[s] != 0) entropyBits -= counts[s] * log2((double)counts[s] / corpus.size());
+        }
+
+        // Старый путь: коды строками из '0' и '1'
+        string legacyInput = corpus.substr(0, LEGACY_LIMIT);
+        string legacyEncoded;
+        string legacyDecoded;
+        double legacyEncode = measureMicroseconds([&] { legacyEncoded = encodeString(legacyInput, huffmanCodes); });
+        double legacyDecode = measureMicroseconds([&] { legacyDecoded = decodeString(legacyEncoded, huffmanTree); });
+        cleanupHuffmanTree(huffmanTree);
+
+        // Канонические коды и битовый поток
+        vector<uint8_t> packed;
+        string decoded;
+        double canonicalEncode = measureMicroseconds([&] { packed = encodeCanonical(corpus, canonical); });
+        double canonicalDecode = measureMicroseconds([&] { decoded = decodeCanonical(packed, corpus.size(), canonical); });
+        if (decoded != corpus || legacyDecoded != legacyInput) {
+            throw runtime_error("Ошибка: набор " + name + " распакован неверно");
+        }
+        uint64_t compressed = 256 + packed.size(); // таблица длин + поток
+
+        cout.setf(ios::fixed);
+        cout.precision(1);
+        cout << name << string(10 - name.size(), ' ');
+        cout.width(12); cout << (uint64_t)(entropyBits / 8);
+        cout.width(10); cout << compressed;
+        cout.width(12); cout << pointerBuild;
+        cout.width(13); cout << flatBuild;
+        cout.width(14); cout << megabytesPerSecond(legacyInput.size(), legacyEncode) << " / ";
+        cout.width(8); cout << megabytesPerSecond(legacyInput.size(), legacyDecode);
+        cout.width(14); cout << megabytesPerSecond(corpus.size(), canonicalEncode) << " / ";
+        cout.width(8); cout << megabytesPerSecond(corpus.size(), canonicalDecode) << endl;
+
+        json += "    {\"corpus\": \"" + name + "\", \"bytes\": " + to_string(corpus.size())
+            + ", \"entropy_bytes\": " + to_string((uint64_t)(entropyBits / 8))
+            + ", \"compressed_bytes\": " + to_string(compressed)
+            + ", \"build_us\": {\"pointer_tree\": " + to_string(pointerBuild) + ", \"flat\": " + to_string(flatBuild) + "}"
+            + ", \"encode_mb_s\": {\"strings\": " + to_string(megabytesPerSecond(legacyInput.size(), legacyEncode))
+            + ", \"canonical\": " + to_string(megabytesPerSecond(corpus.size(), canonicalEncode)) + "}"
+            + ", \"decode_mb_s\": {\"strings\": " + to_string(megabytesPerSecond(legacyInput.size(), legacyDecode))
+            + ", \"canonical\": " + to_string(megabytesPerSecond(corpus.size(), canonicalDecode)) + "}}"
+            + (c + 1 < CORPUS_NAMES.size() ? ",\n" : "\n");
+    }
+    json += "  ]\n}\n";
+
+    if (!jsonPath.empty()) {
+        ofstream out(jsonPath);
+        out << json;
+        if (!out) {
+            throw runtime_error("Ошибка записи в " + jsonPath);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
     setlocale(LC_ALL, "RU");
+
+    // Режим работы с файлами:
+    //   lr2n5 compress|decompress <вход> <выход>
+    //   lr2n5 bcompress|bdecompress <вход> <выход> [потоки] - блочный параллельный режим
+    //   lr2n5 bextract <вход> <номер блока> <выход>
+    //   lr2n5 acompress|adecompress <вход> <выход> - адаптивный режим за один проход ("-" - stdin/stdout)
+    //   lr2n5 histbench [МБ], lenbench <файлы>, bench [МБ] [JSON] - замеры
+    if (argc > 1) {
+        string command = argv[1];
+        bool known = ((command == "compress" || command == "decompress") && argc == 4)
+            || ((command == "acompress" || command == "adecompress") && argc == 4)
+            || ((command == "bcompress" || command == "bdecompress") && (argc == 4 || argc == 5))
+            || (command == "bextract" && argc == 5)
+            || (command == "histbench" && argc <= 3)
+            || (command == "lenbench" && argc >= 3)
+            || (command == "bench" && argc <= 4);
+        if (!known) {
+            cerr << "Использование:\n"
+                << "  " << argv[0] << " compress|decompress <входной файл> <выходной файл>\n"
+                << "  " << argv[0] << " bcompress|bdecompress <входной файл> <выходной файл> [потоки]\n"
+                << "  " << argv[0] << " bextract <сжатый файл> <номер блока> <выходной файл>\n"
+                << "  " << argv[0] << " acompress|adecompress <вход или -> <выход или ->\n"
+                << "  " << argv[0] << " histbench [размер в МБ]\n"
+                << "  " << argv[0] << " lenbench <файл>...\n"
+                << "  " << argv[0] << " bench [размер в МБ] [файл для JSON]" << endl;
+            return 1;
+        }
+        try {
+            size_t threads = thread::hardware_concurrency();
+            if ((command == "bcompress" || command == "bdecompress") && argc == 5) threads = stoul(argv[4]);
+            if (command == "bench") {
+                benchmarkCompression(argc >= 3 ? stoul(argv[2]) : 8, argc == 4 ? argv[3] : "");
+            }
+            else if (command == "lenbench") {
+                benchmarkLengthLimit(vector<string>(argv + 2, argv + argc));
+            }
+            else if (command == "histbench") {
+                benchmarkHistogram(argc == 3 ? stoul(argv[2]) : 64);
+            }
+            else if (command == "compress") {
+                compressFile(argv[2], argv[3]);
+            }
+            else if (command == "decompress") {
+                decompressFile(argv[2], argv[3]);
+            }
+            else if (command == "acompress") {
+                compressAdaptive(argv[2], argv[3]);
+            }
+            else if (command == "adecompress") {
+                decompressAdaptive(argv[2], argv[3]);
+            }
+            else if (command == "bcompress") {
+                compressFileBlocks(argv[2], argv[3], threads);
+            }
+            else if (command == "bdecompress") {
+                decompressFileBlocks(argv[2], argv[3], threads);
+            }
+            else {
+                extractBlock(argv[2], stoul(argv[3]), argv[4]);
+            }
+        }
+        catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
     cout << "Введите исходную строку: ";
     string input;
     getline(cin, input);
@@ -201,6 +1642,22 @@ int main() {
     else {
         cout << "Ошибка декодирования!" << endl;
     }
+
+    // Канонические коды и упакованный битовый поток
+    uint8_t codeLengths[256] = { 0 };
+    getCodeLengths(huffmanTree, codeLengths);
+    CanonicalCode canonical = buildCanonicalCode(codeLengths);
+    vector<uint8_t> packed = encodeCanonical(input, canonical);
+    cout << "\n---------Канонические коды--------" << endl;
+    cout << "Размер упакованного потока: " << packed.size() << " байт (исходная строка: "
+        << input.length() << " байт)" << endl;
+    if (decodeCanonical(packed, input.length(), canonical) == input) {
+        cout << "Табличное декодирование выполнено успешно!" << endl;
+    }
+    else {
+        cout << "Ошибка табличного декодирования!" << endl;
+    }
+
     // Очистка памяти
     cleanupHuffmanTree(huffmanTree);
 
@@ -7,275 +7,2932 @@
 #include <iomanip>
 #include <climits>
 #include <utility>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <functional>
+#include <memory>
+#include <cstdint>
+#include <cmath>
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASH_USE_SSE2 1
+#endif
+#include "WorkloadBench.h"
 using namespace std;
 
-// Базовый класс для хеш-таблицы
+// Хеш-функция по умолчанию: целые ключи берём как есть (как было key % capacity),
+// для остальных типов - std::hash
+template <typename K, bool = is_integral<K>::value>
+struct DefaultHash {
+    size_t operator()(const K& key) const { return hash<K>()(key); }
+};
+
+template <typename K>
+struct DefaultHash<K, true> {
+    size_t operator()(K key) const { return (size_t)key; } // отрицательные ключи дают большое беззнаковое число, а не отрицательный индекс
+};
+
+// Перемешивание битов хеша (финализатор splitmix64) - для второй хеш-функции
+inline size_t mixHash(size_t h) {
+    uint64_t x = h;
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return static_cast<size_t>(x);
+}
+
+// Подсказка процессору заранее загрузить строку кэша с адресом p (для пакетного поиска)
+inline void prefetchRead(const void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p, 0, 3);
+#elif defined(HASH_USE_SSE2)
+    _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+    (void)p;
+#endif
+}
+
+// Сколько ключей пакетного поиска обрабатывается одной группой: столько промахов кэша
+// ожидаются одновременно, а не по очереди
+const int BATCH_GROUP = 16;
+
+// Начало последовательности проб ключа: начальная ячейка и шаг. Считается таблицей один раз
+// за операцию (поиск, вставку, удаление) и передаётся в функтор на каждой попытке, поэтому
+// функторы пробирования не хранят состояния и могут использоваться из нескольких потоков
+struct ProbeStart {
+    size_t home;
+    size_t step;
+};
+
+// Линейное пробирование: следующая ячейка после занятой.
+// Хеш сначала приводится по модулю ёмкости: хеш отрицательного ключа близок к 2^64,
+// и сумма с номером попытки переполнилась бы, пропустив часть ячеек
+struct LinearProbing {
+    ProbeStart start(size_t hashValue, size_t capacity) const {
+        return ProbeStart{ hashValue % capacity, 1 };
+    }
+    size_t operator()(const ProbeStart& start, size_t attempt, size_t capacity) const {
+        return (start.home + attempt) % capacity;
+    }
+};
+
+// Квадратичное пробирование с шагами 1, 2, 3, ... (смещения - треугольные числа).
+// При ёмкости - степени двойки обходит все ячейки, иначе может пропустить часть из них
+struct QuadraticProbing {
+    ProbeStart start(size_t hashValue, size_t capacity) const {
+        return ProbeStart{ hashValue % capacity, 1 };
+    }
+    size_t operator()(const ProbeStart& start, size_t attempt, size_t capacity) const {
+        return (start.home + attempt * (attempt + 1) / 2 % capacity) % capacity;
+    }
+};
+
+// Двойное хеширование: шаг берётся из второй хеш-функции, поэтому ключи с одной
+// начальной ячейкой расходятся. Шаг взаимно прост с ёмкостью - иначе последовательность
+// обходит только часть ячеек и вставка упирается в заполненный цикл. Подбор шага стоит
+// нескольких делений, поэтому он делается в start, а не на каждой попытке
+struct DoubleHashing {
+    ProbeStart start(size_t hashValue, size_t capacity) const {
+        return ProbeStart{ hashValue % capacity, capacity < 2 ? 1 : step(hashValue, capacity) };
+    }
+    size_t operator()(const ProbeStart& start, size_t attempt, size_t capacity) const {
+        return (start.home + attempt * start.step) % capacity;
+    }
+
+    // Шаг от 1 до capacity - 1, взаимно простой с ёмкостью
+    static size_t step(size_t hashValue, size_t capacity) {
+        size_t result = mixHash(hashValue) % (capacity - 1) + 1;
+        if ((capacity & (capacity - 1)) == 0) return result | 1; //при ёмкости 2^k достаточно нечётного шага
+        while (gcd(result, capacity) != 1) result = result % (capacity - 1) + 1;
+        return result;
+    }
+
+    static size_t gcd(size_t a, size_t b) {
+        while (b != 0) {
+            size_t t = a % b;
+            a = b;
+            b = t;
+        }
+        return a;
+    }
+};
+
+// Статистика длины пробирования: сколько ячеек просматривает успешный поиск каждого ключа
+struct ProbeStats {
+    vector<int> histogram; // histogram[i] - число ключей, найденных за i+1 проб
+    long long total = 0;
+    int maxLength = 0;
+    int count = 0;
+
+    void add(int probes) {
+        if ((int)histogram.size() < probes) histogram.resize(probes, 0);
+        histogram[probes - 1]++;
+        total += probes;
+        maxLength = std::max(maxLength, probes);
+        count++;
+    }
+
+    double mean() const { return count == 0 ? 0 : static_cast<double>(total) / count; }
+};
+
+// Пороги заполнения для автоматического расширения таблиц. NO_RESIZE - ёмкость не меняется
+const double NO_RESIZE = 0;
+const double DEFAULT_CHAIN_LOAD_FACTOR = 1.0;  // в среднем один элемент на цепочку
+const double DEFAULT_OPEN_LOAD_FACTOR = 0.75;  // дальше пробирование быстро удлиняется
+const double DEFAULT_DELETED_RATIO = 0.25;     // доля удалённых ячеек, после которой таблица перестраивается
+
+// Функция для вывода ключа или значения в toString
+template <typename T>
+string toText(const T& value) {
+    ostringstream out;
+    out << value;
+    return out.str();
+}
+
+// Базовый класс для хеш-таблицы (виртуальные методы - когда тип таблицы выбирается во время работы)
 class HashTable {
-protected:
+public:
+    virtual ~HashTable() {}
+
+    virtual void add(pair<int, int> keyValue) = 0;
+    virtual void remove(int key) = 0;
+    virtual pair<bool, int> contains(int key) = 0; // возвращает (найдено ли, значение)
+    virtual string toString() = 0;
+
+    virtual int getSize() const = 0;
+    virtual int getCapacity() const = 0;
+    double getLoadFactor() const { return static_cast<double>(getSize()) / getCapacity(); }
+};
+
+// Обёртка, которая делает любую шаблонную таблицу с ключами и значениями int наследником HashTable
+template <typename Table>
+class VirtualHashTable : public HashTable {
+private:
+    Table table;
+
+public:
+    VirtualHashTable(int capacity) : table(capacity) {}
+
+    void add(pair<int, int> keyValue) override { table.add(keyValue); }
+    void remove(int key) override { table.remove(key); }
+    pair<bool, int> contains(int key) override { return table.contains(key); }
+    string toString() override { return table.toString(); }
+    int getSize() const override { return table.getSize(); }
+    int getCapacity() const override { return table.getCapacity(); }
+};
+
+// Узел для метода цепочек
+template <typename K, typename V>
+struct Node {
+    pair<K, V> keyValue; // пара ключ-значение
+    Node* next;
+    Node(const K& k, const V& v) : keyValue(make_pair(k, v)), next(nullptr) {}
+};
+
+// Метод цепочек в прежнем виде: узел через new на каждую вставку, добавление в конец цепочки
+// после отдельного поиска. Оставлен для сравнения с ChainingTable (lr2n6 nodebench)
+template <typename K, typename V, typename Hash = DefaultHash<K>>
+class ListChainingTable {
+private:
+    typedef Node<K, V> ChainNode;
+
     int capacity; //размер таблицы
     int size;//количество элементов
+    vector<ChainNode*> table;//вектор указателей на узлы
+    Hash hasher;
+    double maxLoadFactor; //при превышении таблица увеличивается вдвое
+    int rehashCount; //сколько раз таблица перестраивалась
+
+    int hash(const K& key) const {
+        return static_cast<int>(hasher(key) % capacity);
+    }
+
+    // Перенос узлов в таблицу нового размера - сами узлы не копируются, меняются только ссылки
+    void rehash(int newCapacity) {
+        vector<ChainNode*> newTable(newCapacity, nullptr);
+        for (int i = 0; i < capacity; i++) {
+            ChainNode* current = table[i];
+            while (current != nullptr) {
+                ChainNode* next = current->next;
+                int h = static_cast<int>(hasher(current->keyValue.first) % newCapacity);
+                current->next = newTable[h];
+                newTable[h] = current;
+                current = next;
+            }
+        }
+        table.swap(newTable);
+        capacity = newCapacity;
+        rehashCount++;
+    }
 
 public:
-    HashTable(int capacity) : capacity(capacity), size(0) {}
-    virtual ~HashTable() {}
+    ListChainingTable(int capacity, double maxLoadFactor = DEFAULT_CHAIN_LOAD_FACTOR)
+        : capacity(capacity < 1 ? 1 : capacity), size(0), maxLoadFactor(maxLoadFactor), rehashCount(0) {
+        table.resize(this->capacity, nullptr);
+    }
+
+    ~ListChainingTable() {
+        for (int i = 0; i < capacity; i++) {
+            ChainNode* current = table[i];
+            while (current != nullptr) {
+                ChainNode* temp = current;
+                current = current->next;
+                delete temp;
+            }
+        }
+    }
+
+    ListChainingTable(const ListChainingTable&) = delete;
+    ListChainingTable& operator=(const ListChainingTable&) = delete;
+
+    int getSize() const { return size; }
+    int getCapacity() const { return capacity; }
+    double getLoadFactor() const { return static_cast<double>(size) / capacity; }
+    int getRehashCount() const { return rehashCount; }
+
+    // Заранее выделить место под expectedCount элементов, чтобы при вставке не было перестроений
+    void reserve(int expectedCount) {
+        double loadFactor = maxLoadFactor > 0 ? maxLoadFactor : 1.0;
+        int needed = static_cast<int>(ceil(expectedCount / loadFactor));
+        if (needed > capacity) rehash(needed);
+    }
+
+    void add(const pair<K, V>& keyValue) {
+        auto result = contains(keyValue.first);
+        if (result.first) return; //проверка на дубликаты
+
+        if (maxLoadFactor > 0 && size + 1 > maxLoadFactor * capacity) {
+            rehash(capacity * 2); //удвоение даёт амортизированно O(1) на вставку
+        }
+
+        int h = hash(keyValue.first); //вычисляем хэш значение по ключу
+        ChainNode* newNode = new ChainNode(keyValue.first, keyValue.second); //создаём новый узел с парой ключ-значение
+
+        if (table[h] == nullptr) { //вставка в таблицу если это первый элемент в цепочке будет
+            table[h] = newNode;
+        }
+        else { //коллизия
+            ChainNode* current = table[h]; //указывает на узел первый в цепочке, на саму ячейку
+            while (current->next != nullptr) {
+                current = current->next;//проходим до конца цепочки
+            }
+            current->next = newNode; //добавляем в конец цепочки узел новый
+        }
+        size++;
+    }
+
+    void remove(const K& key) { //удалить 
+        int h = hash(key);
+        ChainNode* current = table[h];
+        ChainNode* prev = nullptr; //для отслеживания предыдущего узла
+
+        while (current != nullptr) {
+            if (current->keyValue.first == key) {
+                if (prev == nullptr) {
+                    table[h] = current->next; //удаляем первый элемент цепочки
+                }
+                else {
+                    prev->next = current->next; //из середины или конца
+                }
+                delete current;
+                size--;
+                return;
+            }
+            prev = current;
+            current = current->next;
+        }
+    }
+
+    pair<bool, V> contains(const K& key) const {//поиск - возвращает (найдено ли, значение)
+        int h = hash(key);
+        ChainNode* current = table[h];//начало цепочки
+
+        while (current != nullptr) {//проходим по цепочке
+            if (current->keyValue.first == key) {
+                return make_pair(true, current->keyValue.second);//нашли - возвращаем значение
+            }
+            current = current->next;
+        }
+        return make_pair(false, V()); // не найдено
+    }
+
+    string toString() const {
+        string result;
+        for (int i = 0; i < capacity; i++) {
+            result += "[" + std::to_string(i) + "]: ";
+            ChainNode* current = table[i];
+            while (current != nullptr) {
+                result += "(" + toText(current->keyValue.first) + "," + 
+                         toText(current->keyValue.second) + ") -> ";
+                current = current->next;
+            }
+            result += "null\n";
+        }
+        return result;
+    }
+    // Для анализа длины цепочек
+    void getChainLengths(int& minLength, int& maxLength, double& avgLength) const {
+        minLength = INT_MAX;
+        maxLength = 0;
+        int totalLength = 0;
+        int nonEmptyChains = 0;
+
+        for (int i = 0; i < capacity; i++) {
+            int length = 0;
+            ChainNode* current = table[i];
+            while (current != nullptr) {
+                length++;
+                current = current->next;
+            }
+
+            if (length > 0) {
+                minLength = std::min(minLength, length);
+                maxLength = std::max(maxLength, length);
+                totalLength += length;
+                nonEmptyChains++;
+            }
+        }
+
+        if (nonEmptyChains == 0) {
+            minLength = 0;
+            avgLength = 0;
+        }
+        else {
+            avgLength = static_cast<double>(totalLength) / nonEmptyChains;
+        }
+    }
+};
+
+// Пул узлов: память выделяется блоками (от 64 до 4096 узлов), освобождённые узлы складываются
+// в список свободных и переиспользуются - вставка и удаление обходятся без new/delete,
+// а при уничтожении таблицы блоки освобождаются целиком
+template <typename T>
+class NodePool {
+private:
+    union Cell {
+        Cell* nextFree;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+    static const size_t MIN_SLAB = 64;
+    static const size_t MAX_SLAB = 4096;
+
+    vector<unique_ptr<Cell[]>> slabs;
+    size_t slabCapacity; // размер последнего блока
+    size_t slabUsed;     // сколько ячеек последнего блока уже выдано
+    size_t reserved;     // всего ячеек во всех блоках
+    Cell* freeList;
+
+public:
+    NodePool() : slabCapacity(0), slabUsed(0), reserved(0), freeList(nullptr) {}
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        Cell* cell;
+        if (freeList != nullptr) {
+            cell = freeList;
+            freeList = freeList->nextFree;
+        }
+        else {
+            if (slabUsed == slabCapacity) {
+                slabCapacity = slabCapacity == 0 ? MIN_SLAB : (slabCapacity * 2 < MAX_SLAB ? slabCapacity * 2 : MAX_SLAB);
+                slabs.emplace_back(new Cell[slabCapacity]);
+                slabUsed = 0;
+                reserved += slabCapacity;
+            }
+            cell = &slabs.back()[slabUsed++];
+        }
+        return new (cell->storage) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* object) {
+        object->~T();
+        Cell* cell = reinterpret_cast<Cell*>(object);
+        cell->nextFree = freeList;
+        freeList = cell;
+    }
+
+    size_t bytesReserved() const { return reserved * sizeof(Cell); }
+};
+
+const int CHAIN_INLINE = 2; // сколько элементов цепочки лежит прямо в ячейке таблицы
+
+// Метод цепочек. Все методы не виртуальные, поэтому в циклах вставки и поиска они встраиваются.
+// Первые CHAIN_INLINE элементов цепочки хранятся в самой ячейке (при заполнении около 1 узлы почти
+// не нужны), остальные - в узлах из NodePool, новые добавляются в начало списка
+template <typename K, typename V, typename Hash = DefaultHash<K>>
+class ChainingTable {
+private:
+    typedef Node<K, V> ChainNode;
+
+    struct Bucket {
+        pair<K, V> items[CHAIN_INLINE];
+        int count; // занято элементов в items
+        ChainNode* overflow; // продолжение цепочки
+        Bucket() : count(0), overflow(nullptr) {}
+    };
+
+    int capacity; //размер таблицы
+    int size;//количество элементов
+    vector<Bucket> table;
+    NodePool<ChainNode> pool;
+    Hash hasher;
+    double maxLoadFactor; //при превышении таблица увеличивается вдвое
+    int rehashCount; //сколько раз таблица перестраивалась
+
+    int hash(const K& key) const {
+        return static_cast<int>(hasher(key) % capacity);
+    }
+
+    // Элемент в ячейку: на свободное место внутри или узлом в начало списка
+    void place(Bucket& bucket, pair<K, V>&& item) {
+        if (bucket.count < CHAIN_INLINE) {
+            bucket.items[bucket.count++] = std::move(item);
+            return;
+        }
+        ChainNode* node = pool.create(std::move(item.first), std::move(item.second));
+        node->next = bucket.overflow;
+        bucket.overflow = node;
+    }
+
+    // Перенос в таблицу нового размера. Узлы, которым нашлось место внутри новой ячейки,
+    // возвращаются в пул, остальные перецепляются без копирования
+    void rehash(int newCapacity) {
+        vector<Bucket> oldTable(newCapacity);
+        oldTable.swap(table);
+        capacity = newCapacity;
+        for (Bucket& bucket : oldTable) {
+            for (int i = 0; i < bucket.count; i++) {
+                place(table[hash(bucket.items[i].first)], std::move(bucket.items[i]));
+            }
+            ChainNode* current = bucket.overflow;
+            while (current != nullptr) {
+                ChainNode* next = current->next;
+                Bucket& target = table[hash(current->keyValue.first)];
+                if (target.count < CHAIN_INLINE) {
+                    target.items[target.count++] = std::move(current->keyValue);
+                    pool.destroy(current);
+                }
+                else {
+                    current->next = target.overflow;
+                    target.overflow = current;
+                }
+                current = next;
+            }
+        }
+        rehashCount++;
+    }
+
+public:
+    ChainingTable(int capacity, double maxLoadFactor = DEFAULT_CHAIN_LOAD_FACTOR)
+        : capacity(capacity < 1 ? 1 : capacity), size(0), maxLoadFactor(maxLoadFactor), rehashCount(0) {
+        table.resize(this->capacity);
+    }
+
+    ~ChainingTable() {
+        // Узлы простых типов (int, int) не требуют деструкторов - память блоков освобождает пул
+        if (!is_trivially_destructible<ChainNode>::value) {
+            for (Bucket& bucket : table) {
+                ChainNode* current = bucket.overflow;
+                while (current != nullptr) {
+                    ChainNode* next = current->next;
+                    pool.destroy(current);
+                    current = next;
+                }
+            }
+        }
+    }
+
+    ChainingTable(const ChainingTable&) = delete;
+    ChainingTable& operator=(const ChainingTable&) = delete;
+
+    int getSize() const { return size; }
+    int getCapacity() const { return capacity; }
+    double getLoadFactor() const { return static_cast<double>(size) / capacity; }
+    int getRehashCount() const { return rehashCount; }
+    // Память под данные: ячейки таблицы и блоки узлов
+    size_t getMemoryBytes() const { return table.capacity() * sizeof(Bucket) + pool.bytesReserved(); }
+
+    // Заранее выделить место под expectedCount элементов, чтобы при вставке не было перестроений
+    void reserve(int expectedCount) {
+        double loadFactor = maxLoadFactor > 0 ? maxLoadFactor : 1.0;
+        int needed = static_cast<int>(ceil(expectedCount / loadFactor));
+        if (needed > capacity) rehash(needed);
+    }
+
+    // Поиск и вставка за один проход по цепочке
+    void add(const pair<K, V>& keyValue) {
+        Bucket* bucket = &table[hash(keyValue.first)];
+        for (int i = 0; i < bucket->count; i++) {
+            if (bucket->items[i].first == keyValue.first) return; //дубликат
+        }
+        for (ChainNode* current = bucket->overflow; current != nullptr; current = current->next) {
+            if (current->keyValue.first == keyValue.first) return;
+        }
+
+        if (maxLoadFactor > 0 && size + 1 > maxLoadFactor * capacity) {
+            rehash(capacity * 2); //удвоение даёт амортизированно O(1) на вставку
+            bucket = &table[hash(keyValue.first)];
+        }
+        place(*bucket, pair<K, V>(keyValue));
+        size++;
+    }
+
+    void remove(const K& key) {
+        Bucket& bucket = table[hash(key)];
+        for (int i = 0; i < bucket.count; i++) {
+            if (bucket.items[i].first == key) {
+                // На освободившееся место - первый узел списка или последний элемент ячейки
+                if (bucket.overflow != nullptr) {
+                    ChainNode* head = bucket.overflow;
+                    bucket.items[i] = std::move(head->keyValue);
+                    bucket.overflow = head->next;
+                    pool.destroy(head);
+                }
+                else {
+                    bucket.items[i] = std::move(bucket.items[bucket.count - 1]);
+                    bucket.count--;
+                }
+                size--;
+                return;
+            }
+        }
+        ChainNode* prev = nullptr; //для отслеживания предыдущего узла
+        for (ChainNode* current = bucket.overflow; current != nullptr; prev = current, current = current->next) {
+            if (current->keyValue.first == key) {
+                if (prev == nullptr) bucket.overflow = current->next;
+                else prev->next = current->next;
+                pool.destroy(current);
+                size--;
+                return;
+            }
+        }
+    }
+
+    pair<bool, V> contains(const K& key) const {//поиск - возвращает (найдено ли, значение)
+        const Bucket& bucket = table[hash(key)];
+        for (int i = 0; i < bucket.count; i++) {
+            if (bucket.items[i].first == key) return make_pair(true, bucket.items[i].second);
+        }
+        for (ChainNode* current = bucket.overflow; current != nullptr; current = current->next) {
+            if (current->keyValue.first == key) return make_pair(true, current->keyValue.second);
+        }
+        return make_pair(false, V()); // не найдено
+    }
+
+    // Пакетный поиск: по группам из BATCH_GROUP ключей сначала считаются все хеши и
+    // запрашиваются ячейки, затем проверяются элементы внутри ячеек и запрашиваются первые
+    // узлы списков, и только потом идёт проход по спискам
+    void containsBatch(const vector<K>& keys, vector<pair<bool, V>>& results) const {
+        results.resize(keys.size());
+        const Bucket* buckets[BATCH_GROUP];
+        for (size_t start = 0; start < keys.size(); start += BATCH_GROUP) {
+            size_t count = std::min(keys.size() - start, (size_t)BATCH_GROUP);
+            for (size_t j = 0; j < count; j++) {
+                buckets[j] = &table[hash(keys[start + j])];
+                prefetchRead(buckets[j]);
+            }
+            for (size_t j = 0; j < count; j++) {
+                const Bucket& bucket = *buckets[j];
+                const K& key = keys[start + j];
+                results[start + j] = make_pair(false, V());
+                for (int i = 0; i < bucket.count; i++) {
+                    if (bucket.items[i].first == key) {
+                        results[start + j] = make_pair(true, bucket.items[i].second);
+                        break;
+                    }
+                }
+                if (results[start + j].first || bucket.overflow == nullptr) buckets[j] = nullptr; //ответ уже есть
+                else prefetchRead(bucket.overflow);
+            }
+            for (size_t j = 0; j < count; j++) {
+                if (buckets[j] == nullptr) continue;
+                const K& key = keys[start + j];
+                for (ChainNode* current = buckets[j]->overflow; current != nullptr; current = current->next) {
+                    if (current->keyValue.first == key) {
+                        results[start + j] = make_pair(true, current->keyValue.second);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    string toString() const {
+        string result;
+        for (int i = 0; i < capacity; i++) {
+            result += "[" + std::to_string(i) + "]: ";
+            const Bucket& bucket = table[i];
+            for (int j = 0; j < bucket.count; j++) {
+                result += "(" + toText(bucket.items[j].first) + "," + toText(bucket.items[j].second) + ") -> ";
+            }
+            for (ChainNode* current = bucket.overflow; current != nullptr; current = current->next) {
+                result += "(" + toText(current->keyValue.first) + "," +
+                         toText(current->keyValue.second) + ") -> ";
+            }
+            result += "null\n";
+        }
+        return result;
+    }
+
+    // Для анализа длины цепочек (элементы внутри ячейки тоже считаются звеньями цепочки)
+    void getChainLengths(int& minLength, int& maxLength, double& avgLength) const {
+        minLength = INT_MAX;
+        maxLength = 0;
+        int totalLength = 0;
+        int nonEmptyChains = 0;
+
+        for (const Bucket& bucket : table) {
+            int length = bucket.count;
+            for (ChainNode* current = bucket.overflow; current != nullptr; current = current->next) length++;
+
+            if (length > 0) {
+                minLength = std::min(minLength, length);
+                maxLength = std::max(maxLength, length);
+                totalLength += length;
+                nonEmptyChains++;
+            }
+        }
+
+        if (nonEmptyChains == 0) {
+            minLength = 0;
+            avgLength = 0;
+        }
+        else {
+            avgLength = static_cast<double>(totalLength) / nonEmptyChains;
+        }
+    }
+};
+
+// Снимок таблицы с открытой адресацией в файле. Файл не содержит указателей, поэтому его можно
+// отобразить в память (mmap) по любому адресу и искать в нём сразу, без перестроения.
+// Раскладка: заголовок SnapshotHeader, байты состояния ячеек (SNAPSHOT_EMPTY/FULL/DELETED),
+// с выравниванием до SNAPSHOT_ALIGN - массив SnapshotEntry, дополненный до кратного 8 байтам
+const char SNAPSHOT_MAGIC[8] = { 'L', 'R', '2', 'N', '6', 'S', 'N', 'P' };
+const uint32_t SNAPSHOT_VERSION = 1;
+const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304; //записывается как есть: на машине с другим порядком байтов не совпадёт
+const size_t SNAPSHOT_ALIGN = 64;
+const int SNAPSHOT_FINGERPRINT_KEYS = 8;
+const unsigned char SNAPSHOT_EMPTY = 0;
+const unsigned char SNAPSHOT_FULL = 1;
+const unsigned char SNAPSHOT_DELETED = 2;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t keySize;
+    uint32_t valueSize;
+    uint64_t capacity;
+    uint64_t size;
+    uint64_t entriesOffset; //смещение массива элементов от начала файла
+    uint64_t fingerprint; //ячейки первых ключей: не совпадёт, если хеш-функция или пробирование другие
+    uint64_t checksum; //по всем байтам после заголовка
+};
+static_assert(sizeof(SnapshotHeader) == 64, "snapshot header layout must not depend on the compiler");
+
+template <typename K, typename V>
+struct SnapshotEntry { //std::pair не тривиально копируемый, поэтому своя пара
+    K key;
+    V value;
+};
+
+// Контрольная сумма по 8-байтовым словам; длина каждого куска кратна 8
+struct SnapshotChecksum {
+    uint64_t value = 0xcbf29ce484222325ULL;
+
+    void add(const char* data, size_t length) {
+        for (size_t i = 0; i < length; i += 8) {
+            uint64_t word;
+            memcpy(&word, data + i, 8);
+            value = (value ^ word) * 0x100000001b3ULL;
+            value ^= value >> 29;
+        }
+    }
+};
+
+inline size_t snapshotEntriesOffset(uint64_t capacity) {
+    return (size_t)((sizeof(SnapshotHeader) + capacity + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN);
+}
+
+inline size_t snapshotFileSize(uint64_t capacity, size_t entrySize) {
+    return (size_t)((snapshotEntriesOffset(capacity) + capacity * entrySize + 7) / 8 * 8);
+}
+
+// Первые SNAPSHOT_FINGERPRINT_KEYS живых ячеек вместе с пробами их ключей.
+// home(key) - пробы 0 и 2 таблицы, которая пишет или читает снимок (на пробе 1 линейное
+// и квадратичное пробирование совпадают)
+template <typename K, typename StateAt, typename KeyAt, typename Home>
+uint64_t snapshotFingerprint(uint64_t capacity, StateAt stateAt, KeyAt keyAt, Home home) {
+    uint64_t fingerprint = 0;
+    int found = 0;
+    for (uint64_t i = 0; i < capacity && found < SNAPSHOT_FINGERPRINT_KEYS; i++) {
+        if (stateAt(i) != SNAPSHOT_FULL) continue;
+        fingerprint = mixHash((size_t)(fingerprint ^ (i << 32) ^ (uint64_t)home(keyAt(i))));
+        found++;
+    }
+    return fingerprint;
+}
+
+// Открытая адресация; схема пробирования задаётся параметром Probe
+template <typename K, typename V, typename Hash = DefaultHash<K>, typename Probe = LinearProbing>
+class OpenAddressingTable {
+private:
+    int capacity; //размер таблицы
+    int size;//количество элементов
+    vector<pair<K, V>> table; // храним пары ключ-значение
+    vector<bool> occupied; //флаги занятости ячеек
+    vector<bool> deleted; //флаг, что ячейка удалялась
+    int deletedCount; //сколько ячеек помечено удалёнными - они тоже удлиняют поиск
+    Hash hasher;
+    Probe probe;
+    double maxLoadFactor; //порог для (элементы + удалённые) / ёмкость
+    double maxDeletedRatio; //порог для доли удалённых ячеек
+    int rehashCount;
+
+    ProbeStart probeStart(const K& key) const { //хеш и шаг ключа - один раз за операцию
+        return probe.start(hasher(key), capacity);
+    }
+
+    int cell(const ProbeStart& start, int attempt) const {//номер ячейки для очередной попытки
+        return static_cast<int>(probe(start, attempt, capacity));
+    }
+
+    int hash(const K& key, int attempt) const {
+        return cell(probeStart(key), attempt);
+    }
+
+    // Перестроение: живые элементы вставляются заново, удалённые ячейки пропадают
+    void rehash(int newCapacity) {
+        vector<pair<K, V>> oldTable(newCapacity);
+        vector<bool> oldOccupied(newCapacity, false);
+        vector<bool> oldDeleted(newCapacity, false);
+        oldTable.swap(table);
+        oldOccupied.swap(occupied);
+        oldDeleted.swap(deleted);
+        int oldCapacity = capacity;
+        capacity = newCapacity;
+        deletedCount = 0;
+
+        for (int i = 0; i < oldCapacity; i++) {
+            if (!oldOccupied[i] || oldDeleted[i]) continue;
+            ProbeStart start = probeStart(oldTable[i].first);
+            for (int attempt = 0; attempt < capacity; attempt++) {
+                int h = cell(start, attempt);
+                if (!occupied[h]) { //ключи различны, поэтому достаточно первой свободной ячейки
+                    table[h] = std::move(oldTable[i]);
+                    occupied[h] = true;
+                    break;
+                }
+            }
+        }
+        rehashCount++;
+    }
+
+    // Проверка перед вставкой: если занятых или удалённых ячеек слишком много - перестраиваем
+    void growIfNeeded() {
+        if (maxLoadFactor <= 0) return;
+        if (size + deletedCount + 1 <= maxLoadFactor * capacity && deletedCount <= maxDeletedRatio * capacity) return;
+        // Если живые элементы занимают больше половины допустимого - удваиваем,
+        // иначе место заняли удалённые ячейки и достаточно перестроить таблицу того же размера.
+        // В обоих случаях до следующего перестроения остаётся не меньше половины порога
+        int newCapacity = capacity;
+        while ((size + 1) * 2 > maxLoadFactor * newCapacity) newCapacity *= 2;
+        rehash(newCapacity);
+    }
+
+public:
+    OpenAddressingTable(int capacity, double maxLoadFactor = DEFAULT_OPEN_LOAD_FACTOR,
+        double maxDeletedRatio = DEFAULT_DELETED_RATIO)
+        : capacity(capacity < 1 ? 1 : capacity), size(0), deletedCount(0),
+        maxLoadFactor(maxLoadFactor), maxDeletedRatio(maxDeletedRatio), rehashCount(0) {
+        table.resize(this->capacity);
+        occupied.resize(this->capacity, false);
+        deleted.resize(this->capacity, false);
+    }
+
+    int getSize() const { return size; }
+    int getCapacity() const { return capacity; }
+    double getLoadFactor() const { return static_cast<double>(size) / capacity; }
+    int getRehashCount() const { return rehashCount; }
+    int getDeletedCount() const { return deletedCount; }
+
+    // Заранее выделить место под expectedCount элементов
+    void reserve(int expectedCount) {
+        double loadFactor = maxLoadFactor > 0 ? maxLoadFactor : 1.0;
+        int needed = static_cast<int>(ceil((expectedCount + 1) / loadFactor));
+        if (needed > capacity) rehash(needed);
+    }
+
+    void add(const pair<K, V>& keyValue) {
+        growIfNeeded();
+
+        int freeSlot = -1; //первая удалённая или пустая ячейка на пути пробирования
+        ProbeStart start = probeStart(keyValue.first);
+        for (int attempt = 0; attempt < capacity; attempt++) {
+            int h = cell(start, attempt);
+            if (!occupied[h]) {
+                if (freeSlot < 0) freeSlot = h;
+                break; //дальше ключа быть не может
+            }
+            if (deleted[h]) {
+                if (freeSlot < 0) freeSlot = h; //занимать её можно, но ключ может встретиться дальше
+                continue;
+            }
+            // Если ячейка занята тем же ключом - это дубликат
+            if (table[h].first == keyValue.first) {
+                return; // дубликат - не увеличиваем size
+            }
+        }
+        if (freeSlot < 0) {
+            // Последовательность проб не нашла свободной ячейки (таблица заполнена или
+            // квадратичное пробирование обошло не все ячейки) - расширяемся, если это разрешено
+            if (maxLoadFactor > 0) {
+                rehash(capacity * 2);
+                add(keyValue);
+                return;
+            }
+            throw std::runtime_error("Hash table is full");
+        }
+        if (deleted[freeSlot]) deletedCount--;
+        table[freeSlot] = keyValue;
+        occupied[freeSlot] = true;
+        deleted[freeSlot] = false;
+        size++;
+    }
+
+    void remove(const K& key) {
+        ProbeStart start = probeStart(key);
+        for (int attempt = 0; attempt < capacity; attempt++) {
+            int h = cell(start, attempt);
+            if (!occupied[h] && !deleted[h]) {
+                return; // Элемент не найден
+            }
+            if (occupied[h] && !deleted[h] && table[h].first == key) {
+                deleted[h] = true;
+                deletedCount++;
+                size--;
+                return;
+            }
+        }
+    }
+
+    pair<bool, V> contains(const K& key) const { //поиск элементов - возвращает (найдено ли, значение)
+        ProbeStart start = probeStart(key);
+        for (int attempt = 0; attempt < capacity; attempt++) {
+            int h = cell(start, attempt);
+            if (!occupied[h] && !deleted[h]) {
+                return make_pair(false, V()); //дошли до пустой ячейки - элемента нет
+            }
+            if (occupied[h] && !deleted[h] && table[h].first == key) {
+                return make_pair(true, table[h].second); // возвращаем значение
+            }
+        }
+        return make_pair(false, V());
+    }
+
+    // Пакетный поиск: по группам из BATCH_GROUP ключей сначала запрашиваются первые ячейки
+    // пробирования всех ключей группы, затем каждый ключ ищется обычным образом -
+    // к этому времени его ячейка (а при линейном пробировании и соседние) уже в кэше
+    void containsBatch(const vector<K>& keys, vector<pair<bool, V>>& results) const {
+        results.resize(keys.size());
+        for (size_t start = 0; start < keys.size(); start += BATCH_GROUP) {
+            size_t count = std::min(keys.size() - start, (size_t)BATCH_GROUP);
+            for (size_t j = 0; j < count; j++) {
+                prefetchRead(&table[hash(keys[start + j], 0)]);
+            }
+            for (size_t j = 0; j < count; j++) {
+                results[start + j] = contains(keys[start + j]);
+            }
+        }
+    }
+
+    // Записать снимок таблицы в файл (см. SnapshotHeader). Удалённые ячейки сохраняются -
+    // без них оборвались бы последовательности проб. Открывается через SnapshotTable
+    void saveSnapshot(const string& path) const {
+        static_assert(is_trivially_copyable<K>::value && is_trivially_copyable<V>::value,
+            "snapshot requires trivially copyable keys and values");
+        typedef SnapshotEntry<K, V> Entry;
+        const size_t CHUNK = 4096; //элементов в буфере записи
+
+        SnapshotHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.byteOrder = SNAPSHOT_BYTE_ORDER;
+        header.keySize = sizeof(K);
+        header.valueSize = sizeof(V);
+        header.capacity = (uint64_t)capacity;
+        header.size = (uint64_t)size;
+        header.entriesOffset = snapshotEntriesOffset(header.capacity);
+        auto stateAt = [&](uint64_t i) {
+            if (!occupied[i]) return SNAPSHOT_EMPTY;
+            return deleted[i] ? SNAPSHOT_DELETED : SNAPSHOT_FULL;
+        };
+        header.fingerprint = snapshotFingerprint<K>(header.capacity, stateAt,
+            [&](uint64_t i) -> const K& { return table[i].first; },
+            [&](const K& key) { return (uint64_t)hash(key, 0) << 32 ^ (uint64_t)hash(key, 2); });
+
+        ofstream out(path, ios::binary | ios::trunc);
+        if (!out) throw runtime_error("Cannot create snapshot " + path + ": " + strerror(errno));
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        SnapshotChecksum checksum;
+
+        vector<char> states(header.entriesOffset - sizeof(header), 0);
+        for (int i = 0; i < capacity; i++) states[i] = (char)stateAt(i);
+        checksum.add(states.data(), states.size());
+        out.write(states.data(), states.size());
+
+        vector<char> buffer(CHUNK * sizeof(Entry) + 8);
+        for (int start = 0; start < capacity; start += (int)CHUNK) {
+            int end = capacity - start < (int)CHUNK ? capacity : start + (int)CHUNK;
+            memset(buffer.data(), 0, buffer.size()); //байты выравнивания тоже попадают в сумму
+            Entry* entries = reinterpret_cast<Entry*>(buffer.data());
+            for (int i = start; i < end; i++) {
+                if (stateAt(i) == SNAPSHOT_FULL) {
+                    entries[i - start].key = table[i].first;
+                    entries[i - start].value = table[i].second;
+                }
+            }
+            size_t bytes = (end - start) * sizeof(Entry);
+            if (end == capacity) bytes = (bytes + 7) / 8 * 8;
+            checksum.add(buffer.data(), bytes);
+            out.write(buffer.data(), bytes);
+        }
+
+        header.checksum = checksum.value;
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.close();
+        if (!out) throw runtime_error("Cannot write snapshot " + path);
+    }
+
+    // Длина успешного поиска каждого ключа: номер попытки, на которой пробирование попадает в его ячейку
+    ProbeStats getProbeStats() const {
+        ProbeStats stats;
+        for (int i = 0; i < capacity; i++) {
+            if (!occupied[i] || deleted[i]) continue;
+            ProbeStart start = probeStart(table[i].first);
+            int attempt = 0;
+            while (cell(start, attempt) != i) attempt++;
+            stats.add(attempt + 1);
+        }
+        return stats;
+    }
+
+    string toString() const { //для визуального вывода таблицы
+        string result;
+        for (int i = 0; i < capacity; i++) {
+            result += "[" + to_string(i) + "]: ";
+            if (occupied[i] && !deleted[i]) {
+                result += "(" + toText(table[i].first) + "," + toText(table[i].second) + ")";
+            } else if (deleted[i]) {
+                result += "deleted";
+            } else {
+                result += "empty";
+            }
+            result += "\n";
+        }
+        return result;
+    }
+};
+
+// Снимок OpenAddressingTable, открытый только для чтения. На Linux файл отображается в память:
+// открытие стоит проверки заголовка, а страницы подгружаются при первых обращениях к ним.
+// В остальных системах файл читается целиком. Hash и Probe должны совпадать с таблицей,
+// которая записала снимок, - это проверяется по отпечатку в заголовке
+template <typename K, typename V, typename Hash = DefaultHash<K>, typename Probe = LinearProbing>
+class SnapshotTable {
+private:
+    typedef SnapshotEntry<K, V> Entry;
+    const char* data;
+    size_t length;
+    vector<char> buffer; //содержимое файла, если mmap недоступен
+    SnapshotHeader header;
+    const unsigned char* states;
+    const Entry* entries;
+    int capacity;
+    Hash hasher;
+    Probe probe;
+
+    ProbeStart probeStart(const K& key) const {
+        return probe.start(hasher(key), capacity);
+    }
+
+    int cell(const ProbeStart& start, int attempt) const {
+        return static_cast<int>(probe(start, attempt, capacity));
+    }
+
+    int hash(const K& key, int attempt) const {
+        return cell(probeStart(key), attempt);
+    }
+
+    void release() {
+#ifdef __linux__
+        if (data != nullptr && buffer.empty()) munmap(const_cast<char*>(data), length);
+#endif
+        data = nullptr;
+    }
+
+    void load(const string& path) {
+#ifdef __linux__
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw runtime_error("Cannot open snapshot " + path + ": " + strerror(errno));
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw runtime_error("Cannot stat snapshot " + path + ": " + strerror(errno));
+        }
+        length = (size_t)info.st_size;
+        if (length < sizeof(SnapshotHeader)) {
+            close(fd);
+            throw runtime_error("Snapshot " + path + " is truncated");
+        }
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd); //отображение остаётся действительным и после закрытия файла
+        if (mapped == MAP_FAILED) throw runtime_error("Cannot map snapshot " + path + ": " + strerror(errno));
+        data = static_cast<const char*>(mapped);
+#else
+        ifstream in(path, ios::binary);
+        if (!in) throw runtime_error("Cannot open snapshot " + path);
+        buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        length = buffer.size();
+        if (length < sizeof(SnapshotHeader)) throw runtime_error("Snapshot " + path + " is truncated");
+        data = buffer.data();
+#endif
+    }
+
+    void validate(const string& path, bool verifyChecksum) {
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+            throw runtime_error(path + " is not a hash table snapshot");
+        }
+        if (header.version != SNAPSHOT_VERSION) {
+            throw runtime_error("Snapshot " + path + " has version " + to_string(header.version)
+                + ", expected " + to_string(SNAPSHOT_VERSION));
+        }
+        if (header.byteOrder != SNAPSHOT_BYTE_ORDER) throw runtime_error("Snapshot " + path + " has a different byte order");
+        if (header.keySize != sizeof(K) || header.valueSize != sizeof(V)) {
+            throw runtime_error("Snapshot " + path + " stores other key or value types");
+        }
+        if (header.capacity < 1 || header.capacity > (uint64_t)INT_MAX || header.size > header.capacity
+            || header.entriesOffset != snapshotEntriesOffset(header.capacity)
+            || length != snapshotFileSize(header.capacity, sizeof(Entry))) {
+            throw runtime_error("Snapshot " + path + " is truncated or has a damaged header");
+        }
+        capacity = (int)header.capacity;
+        states = reinterpret_cast<const unsigned char*>(data + sizeof(SnapshotHeader));
+        entries = reinterpret_cast<const Entry*>(data + header.entriesOffset);
+        uint64_t fingerprint = snapshotFingerprint<K>(header.capacity,
+            [&](uint64_t i) { return states[i]; },
+            [&](uint64_t i) -> const K& { return entries[i].key; },
+            [&](const K& key) { return (uint64_t)hash(key, 0) << 32 ^ (uint64_t)hash(key, 2); });
+        if (fingerprint != header.fingerprint) {
+            throw runtime_error("Snapshot " + path + " was written with another hash function or probing");
+        }
+        if (verifyChecksum) { //читает весь файл - при быстром старте не нужно
+            SnapshotChecksum checksum;
+            checksum.add(data + sizeof(SnapshotHeader), length - sizeof(SnapshotHeader));
+            if (checksum.value != header.checksum) throw runtime_error("Snapshot " + path + " is damaged (checksum mismatch)");
+        }
+    }
+
+public:
+    explicit SnapshotTable(const string& path, bool verifyChecksum = false) : data(nullptr), length(0) {
+        load(path);
+        try {
+            validate(path, verifyChecksum);
+        }
+        catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    ~SnapshotTable() { release(); }
+
+    SnapshotTable(const SnapshotTable&) = delete;
+    SnapshotTable& operator=(const SnapshotTable&) = delete;
+
+    int getSize() const { return (int)header.size; }
+    int getCapacity() const { return capacity; }
+    size_t getFileBytes() const { return length; }
+
+    pair<bool, V> contains(const K& key) const { //тот же поиск, что в OpenAddressingTable::contains
+        ProbeStart start = probeStart(key);
+        for (int attempt = 0; attempt < capacity; attempt++) {
+            int h = cell(start, attempt);
+            if (states[h] == SNAPSHOT_EMPTY) return make_pair(false, V());
+            if (states[h] == SNAPSHOT_FULL && entries[h].key == key) return make_pair(true, entries[h].value);
+        }
+        return make_pair(false, V());
+    }
+};
+
+// Robin Hood: линейное пробирование, при котором вставляемый элемент, ушедший от своей
+// ячейки дальше, чем текущий жилец, занимает его место. Разброс длин поиска становится малым.
+// Удаление сдвигает следующие элементы назад, поэтому удалённых ячеек не бывает
+template <typename K, typename V, typename Hash = DefaultHash<K>>
+class RobinHoodTable {
+private:
+    int capacity;
+    int size;
+    vector<pair<K, V>> table;
+    vector<int> distance; //расстояние элемента от его ячейки, -1 - пусто
+    Hash hasher;
+    double maxLoadFactor;
+    int rehashCount;
+
+    int home(const K& key) const {
+        return static_cast<int>(hasher(key) % capacity);
+    }
+
+    int find(const K& key) const { //индекс ячейки с ключом или -1
+        int h = home(key);
+        for (int dist = 0; dist < capacity; dist++) {
+            if (distance[h] < dist) return -1; //здесь уже живёт элемент ближе к своей ячейке - нашего ключа дальше нет
+            if (table[h].first == key) return h;
+            h = (h + 1) % capacity;
+        }
+        return -1;
+    }
+
+    void insertNew(pair<K, V> item) { //ключа в таблице точно нет и место есть
+        int h = home(item.first);
+        int dist = 0;
+        while (distance[h] >= 0) {
+            if (distance[h] < dist) { //жилец "богаче" - забираем его ячейку, дальше вставляем его
+                swap(item, table[h]);
+                swap(dist, distance[h]);
+            }
+            h = (h + 1) % capacity;
+            dist++;
+        }
+        table[h] = std::move(item);
+        distance[h] = dist;
+        size++;
+    }
+
+    void rehash(int newCapacity) {
+        vector<pair<K, V>> oldTable(newCapacity);
+        vector<int> oldDistance(newCapacity, -1);
+        oldTable.swap(table);
+        oldDistance.swap(distance);
+        capacity = newCapacity;
+        size = 0;
+        for (size_t i = 0; i < oldTable.size(); i++) {
+            if (oldDistance[i] >= 0) insertNew(std::move(oldTable[i]));
+        }
+        rehashCount++;
+    }
+
+public:
+    RobinHoodTable(int capacity, double maxLoadFactor = DEFAULT_OPEN_LOAD_FACTOR)
+        : capacity(capacity < 1 ? 1 : capacity), size(0), maxLoadFactor(maxLoadFactor), rehashCount(0) {
+        table.resize(this->capacity);
+        distance.resize(this->capacity, -1);
+    }
+
+    int getSize() const { return size; }
+    int getCapacity() const { return capacity; }
+    double getLoadFactor() const { return static_cast<double>(size) / capacity; }
+    int getRehashCount() const { return rehashCount; }
+
+    void reserve(int expectedCount) {
+        double loadFactor = maxLoadFactor > 0 ? maxLoadFactor : 1.0;
+        int needed = static_cast<int>(ceil((expectedCount + 1) / loadFactor));
+        if (needed > capacity) rehash(needed);
+    }
+
+    void add(const pair<K, V>& keyValue) {
+        if (find(keyValue.first) >= 0) return; //дубликат
+        if (maxLoadFactor > 0 && size + 1 > maxLoadFactor * capacity) {
+            rehash(capacity * 2);
+        }
+        if (size == capacity) {
+            throw std::runtime_error("Hash table is full");
+        }
+        insertNew(keyValue);
+    }
+
+    void remove(const K& key) {
+        int i = find(key);
+        if (i < 0) return;
+        // Сдвигаем назад элементы, стоящие не в своей ячейке, пока не встретим пустую или "домашнюю"
+        int next = (i + 1) % capacity;
+        while (distance[next] > 0) {
+            table[i] = std::move(table[next]);
+            distance[i] = distance[next] - 1;
+            i = next;
+            next = (next + 1) % capacity;
+        }
+        distance[i] = -1;
+        size--;
+    }
+
+    pair<bool, V> contains(const K& key) const {
+        int i = find(key);
+        if (i < 0) return make_pair(false, V());
+        return make_pair(true, table[i].second);
+    }
+
+    ProbeStats getProbeStats() const {
+        ProbeStats stats;
+        for (int i = 0; i < capacity; i++) {
+            if (distance[i] >= 0) stats.add(distance[i] + 1);
+        }
+        return stats;
+    }
+
+    string toString() const {
+        string result;
+        for (int i = 0; i < capacity; i++) {
+            result += "[" + to_string(i) + "]: ";
+            if (distance[i] >= 0) {
+                result += "(" + toText(table[i].first) + "," + toText(table[i].second) + ") +" + to_string(distance[i]);
+            } else {
+                result += "empty";
+            }
+            result += "\n";
+        }
+        return result;
+    }
+};
+
+// Кукушкино хеширование: у ключа ровно две возможные ячейки, поэтому поиск - не больше двух проб.
+// Если обе заняты, новый элемент вытесняет жильца в его другую ячейку, и так по цепочке.
+// Когда цепочка вытеснений зацикливается, таблица увеличивается даже при NO_RESIZE -
+// иначе вставка невозможна
+template <typename K, typename V, typename Hash = DefaultHash<K>>
+class CuckooTable {
+private:
+    static const int MAX_KICKS = 64; //длина цепочки вытеснений, после которой считаем, что она зациклилась
+
+    int capacity;
+    int size;
+    vector<pair<K, V>> table;
+    vector<bool> occupied;
+    Hash hasher;
+    double maxLoadFactor;
+    int rehashCount;
+
+    int position(const K& key, int which) const { //первая (0) или вторая (1) ячейка ключа
+        size_t h = hasher(key);
+        if (which == 1) h = mixHash(h);
+        return static_cast<int>(h % capacity);
+    }
+
+    int find(const K& key) const {
+        int p = position(key, 0);
+        if (occupied[p] && table[p].first == key) return p;
+        p = position(key, 1);
+        if (occupied[p] && table[p].first == key) return p;
+        return -1;
+    }
+
+    void insertNew(pair<K, V> item) {
+        int pos = position(item.first, 0);
+        if (occupied[pos]) {
+            int second = position(item.first, 1);
+            if (!occupied[second]) pos = second;
+        }
+        for (int kick = 0; kick < MAX_KICKS; kick++) {
+            if (!occupied[pos]) {
+                table[pos] = std::move(item);
+                occupied[pos] = true;
+                size++;
+                return;
+            }
+            swap(item, table[pos]); //вытесняем жильца, он идёт в свою другую ячейку
+            int first = position(item.first, 0);
+            pos = (first == pos) ? position(item.first, 1) : first;
+        }
+        rehash(capacity * 2);
+        insertNew(std::move(item));
+    }
+
+    void rehash(int newCapacity) {
+        vector<pair<K, V>> oldTable(newCapacity);
+        vector<bool> oldOccupied(newCapacity, false);
+        oldTable.swap(table);
+        oldOccupied.swap(occupied);
+        capacity = newCapacity;
+        size = 0;
+        rehashCount++;
+        for (size_t i = 0; i < oldTable.size(); i++) {
+            if (oldOccupied[i]) insertNew(std::move(oldTable[i])); //может снова вызвать rehash - тогда элементы уже в новой таблице
+        }
+    }
+
+public:
+    CuckooTable(int capacity, double maxLoadFactor = 0.5) //при двух ячейках на ключ выше ~0.5 вытеснения зацикливаются
+        : capacity(capacity < 1 ? 1 : capacity), size(0), maxLoadFactor(maxLoadFactor), rehashCount(0) {
+        table.resize(this->capacity);
+        occupied.resize(this->capacity, false);
+    }
+
+    int getSize() const { return size; }
+    int getCapacity() const { return capacity; }
+    double getLoadFactor() const { return static_cast<double>(size) / capacity; }
+    int getRehashCount() const { return rehashCount; }
+
+    void reserve(int expectedCount) {
+        double loadFactor = maxLoadFactor > 0 ? maxLoadFactor : 1.0;
+        int needed = static_cast<int>(ceil((expectedCount + 1) / loadFactor));
+        if (needed > capacity) rehash(needed);
+    }
+
+    void add(const pair<K, V>& keyValue) {
+        if (find(keyValue.first) >= 0) return; //дубликат
+        if (maxLoadFactor > 0 && size + 1 > maxLoadFactor * capacity) {
+            rehash(capacity * 2);
+        }
+        insertNew(keyValue);
+    }
+
+    void remove(const K& key) {
+        int i = find(key);
+        if (i < 0) return;
+        occupied[i] = false;
+        size--;
+    }
+
+    pair<bool, V> contains(const K& key) const {
+        int i = find(key);
+        if (i < 0) return make_pair(false, V());
+        return make_pair(true, table[i].second);
+    }
+
+    ProbeStats getProbeStats() const {
+        ProbeStats stats;
+        for (int i = 0; i < capacity; i++) {
+            if (occupied[i]) stats.add(position(table[i].first, 0) == i ? 1 : 2);
+        }
+        return stats;
+    }
+
+    string toString() const {
+        string result;
+        for (int i = 0; i < capacity; i++) {
+            result += "[" + to_string(i) + "]: ";
+            if (occupied[i]) {
+                result += "(" + toText(table[i].first) + "," + toText(table[i].second) + ")";
+            } else {
+                result += "empty";
+            }
+            result += "\n";
+        }
+        return result;
+    }
+};
+
+// Группа из 16 управляющих байтов: для каждой ячейки - пусто, удалено или 7 бит хеша ключа (метка).
+// Одна проверка группы отвечает сразу на вопрос "в каких из 16 ячеек может быть ключ"
+const int GROUP_SIZE = 16;
+const int8_t CTRL_EMPTY = -128;  // 0x80
+const int8_t CTRL_DELETED = -2;  // 0xFE; у занятых ячеек старший бит 0
+
+struct ControlGroup {
+#ifdef HASH_USE_SSE2
+    __m128i ctrl;
+    explicit ControlGroup(const int8_t* pos) : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+    // Маска ячеек с данной меткой (бит i - ячейка i группы)
+    unsigned match(int8_t tag) const {
+        return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), ctrl));
+    }
+    unsigned matchEmpty() const { return match(CTRL_EMPTY); }
+    // Пустые и удалённые - единственные байты со старшим битом
+    unsigned matchFree() const { return (unsigned)_mm_movemask_epi8(ctrl); }
+#else
+    const int8_t* ctrl;
+    explicit ControlGroup(const int8_t* pos) : ctrl(pos) {}
+
+    unsigned match(int8_t tag) const {
+        unsigned mask = 0;
+        for (int i = 0; i < GROUP_SIZE; i++) if (ctrl[i] == tag) mask |= 1u << i;
+        return mask;
+    }
+    unsigned matchEmpty() const { return match(CTRL_EMPTY); }
+    unsigned matchFree() const {
+        unsigned mask = 0;
+        for (int i = 0; i < GROUP_SIZE; i++) if (ctrl[i] < 0) mask |= 1u << i;
+        return mask;
+    }
+#endif
+};
+
+// Номер младшего установленного бита маски
+inline int lowestBit(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Открытая адресация со структурой массивов: управляющие байты, ключи и значения лежат отдельно.
+// Поиск читает только байты группы и затем ключи с совпавшей меткой, а не три вектора на каждую пробу.
+// Пробирование идёт по группам (квадратично), ёмкость - степень двойки, не меньше 16
+template <typename K, typename V, typename Hash = DefaultHash<K>>
+class GroupedTable {
+private:
+    int capacity;
+    int size;
+    int deletedCount;
+    vector<int8_t> ctrl;
+    vector<K> keys;
+    vector<V> values;
+    Hash hasher;
+    double maxLoadFactor;
+    int rehashCount;
+
+    size_t fullHash(const K& key) const { return mixHash(hasher(key)); } //биты перемешаны, иначе метки у целых ключей совпадали бы
+    static int8_t tagOf(size_t h) { return (int8_t)(h & 0x7F); }
+    int firstGroup(size_t h) const { return (int)((h >> 7) & (capacity / GROUP_SIZE - 1)); }
+
+    int find(const K& key) const { //индекс ячейки с ключом или -1
+        size_t h = fullHash(key);
+        int8_t tag = tagOf(h);
+        int groups = capacity / GROUP_SIZE;
+        int group = firstGroup(h);
+        for (int attempt = 0; attempt < groups; attempt++) {
+            ControlGroup g(&ctrl[group * GROUP_SIZE]);
+            for (unsigned mask = g.match(tag); mask != 0; mask &= mask - 1) {
+                int i = group * GROUP_SIZE + lowestBit(mask);
+                if (keys[i] == key) return i;
+            }
+            if (g.matchEmpty() != 0) return -1; //в группе есть пустая ячейка - дальше ключ не уходил
+            group = (group + attempt + 1) & (groups - 1);
+        }
+        return -1;
+    }
+
+    int findFree(size_t h) const { //первая пустая или удалённая ячейка на пути пробирования
+        int groups = capacity / GROUP_SIZE;
+        int group = firstGroup(h);
+        for (int attempt = 0; attempt < groups; attempt++) {
+            unsigned mask = ControlGroup(&ctrl[group * GROUP_SIZE]).matchFree();
+            if (mask != 0) return group * GROUP_SIZE + lowestBit(mask);
+            group = (group + attempt + 1) & (groups - 1);
+        }
+        return -1;
+    }
+
+    static int roundCapacity(int capacity) {
+        int result = GROUP_SIZE;
+        while (result < capacity) result *= 2;
+        return result;
+    }
+
+    void rehash(int newCapacity) {
+        vector<int8_t> oldCtrl(newCapacity, CTRL_EMPTY);
+        vector<K> oldKeys(newCapacity);
+        vector<V> oldValues(newCapacity);
+        oldCtrl.swap(ctrl);
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        capacity = newCapacity;
+        deletedCount = 0;
+        for (size_t i = 0; i < oldCtrl.size(); i++) {
+            if (oldCtrl[i] < 0) continue;
+            size_t h = fullHash(oldKeys[i]);
+            int slot = findFree(h);
+            ctrl[slot] = tagOf(h);
+            keys[slot] = std::move(oldKeys[i]);
+            values[slot] = std::move(oldValues[i]);
+        }
+        rehashCount++;
+    }
+
+    void growIfNeeded() { //как в OpenAddressingTable: удваиваем или только убираем удалённые
+        if (maxLoadFactor <= 0) return;
+        if (size + deletedCount + 1 <= maxLoadFactor * capacity) return;
+        int newCapacity = capacity;
+        while ((size + 1) * 2 > maxLoadFactor * newCapacity) newCapacity *= 2;
+        rehash(newCapacity);
+    }
+
+public:
+    GroupedTable(int capacity, double maxLoadFactor = 0.875) //группа из 16 байтов позволяет заполнять плотнее
+        : capacity(roundCapacity(capacity)), size(0), deletedCount(0), maxLoadFactor(maxLoadFactor), rehashCount(0) {
+        ctrl.assign(this->capacity, CTRL_EMPTY);
+        keys.resize(this->capacity);
+        values.resize(this->capacity);
+    }
+
+    int getSize() const { return size; }
+    int getCapacity() const { return capacity; }
+    double getLoadFactor() const { return static_cast<double>(size) / capacity; }
+    int getRehashCount() const { return rehashCount; }
+
+    void reserve(int expectedCount) {
+        double loadFactor = maxLoadFactor > 0 ? maxLoadFactor : 1.0;
+        int needed = roundCapacity(static_cast<int>(ceil((expectedCount + 1) / loadFactor)));
+        if (needed > capacity) rehash(needed);
+    }
+
+    void add(const pair<K, V>& keyValue) {
+        if (find(keyValue.first) >= 0) return; //дубликат
+        growIfNeeded();
+        size_t h = fullHash(keyValue.first);
+        int slot = findFree(h);
+        if (slot < 0) {
+            throw std::runtime_error("Hash table is full");
+        }
+        if (ctrl[slot] == CTRL_DELETED) deletedCount--;
+        ctrl[slot] = tagOf(h);
+        keys[slot] = keyValue.first;
+        values[slot] = keyValue.second;
+        size++;
+    }
+
+    void remove(const K& key) {
+        int i = find(key);
+        if (i < 0) return;
+        // Если в группе уже есть пустая ячейка, поиск и так останавливается на ней,
+        // и ячейку можно сделать пустой, а не удалённой
+        int groupStart = i / GROUP_SIZE * GROUP_SIZE;
+        if (ControlGroup(&ctrl[groupStart]).matchEmpty() != 0) {
+            ctrl[i] = CTRL_EMPTY;
+        }
+        else {
+            ctrl[i] = CTRL_DELETED;
+            deletedCount++;
+        }
+        size--;
+    }
+
+    pair<bool, V> contains(const K& key) const {
+        int i = find(key);
+        if (i < 0) return make_pair(false, V());
+        return make_pair(true, values[i]);
+    }
+
+    // Длина поиска в группах: сколько групп по 16 ячеек просматривается до ключа
+    ProbeStats getProbeStats() const {
+        ProbeStats stats;
+        int groups = capacity / GROUP_SIZE;
+        for (int i = 0; i < capacity; i++) {
+            if (ctrl[i] < 0) continue;
+            int group = firstGroup(fullHash(keys[i]));
+            int attempt = 0;
+            while (group != i / GROUP_SIZE) {
+                group = (group + attempt + 1) & (groups - 1);
+                attempt++;
+            }
+            stats.add(attempt + 1);
+        }
+        return stats;
+    }
+
+    string toString() const {
+        string result;
+        for (int i = 0; i < capacity; i++) {
+            result += "[" + to_string(i) + "]: ";
+            if (ctrl[i] >= 0) {
+                result += "(" + toText(keys[i]) + "," + toText(values[i]) + ")";
+            } else if (ctrl[i] == CTRL_DELETED) {
+                result += "deleted";
+            } else {
+                result += "empty";
+            }
+            result += "\n";
+        }
+        return result;
+    }
+};
+
+// ---------------- Потокобезопасная таблица ----------------
+
+// Номер потока для учёта эпох: занимается при первом обращении потока к таблице
+// и освобождается при его завершении, поэтому потоки можно создавать сколько угодно раз
+const int MAX_TABLE_THREADS = 128;
+atomic<bool> threadSlotsUsed[MAX_TABLE_THREADS];
+
+struct ThreadSlot {
+    int index;
+    ThreadSlot() : index(-1) {
+        for (int i = 0; i < MAX_TABLE_THREADS; i++) {
+            bool expected = false;
+            if (threadSlotsUsed[i].compare_exchange_strong(expected, true)) {
+                index = i;
+                return;
+            }
+        }
+        throw runtime_error("too many threads use concurrent tables");
+    }
+    ~ThreadSlot() { threadSlotsUsed[index].store(false); }
+};
+
+inline int currentThreadSlot() {
+    thread_local ThreadSlot slot;
+    return slot.index;
+}
+
+// Освобождение памяти по эпохам. Поток на время операции объявляет текущую эпоху;
+// снятый с таблицы массив помечается эпохой снятия и удаляется, когда все потоки,
+// которые ещё могли его видеть (объявили эпоху не новее), закончили свои операции
+template <typename T>
+class EpochReclaimer {
+private:
+    atomic<uint64_t> globalEpoch;
+    atomic<uint64_t> threadEpochs[MAX_TABLE_THREADS]; // 0 - поток вне операции
+    mutex retiredLock; // снятие массивов редкое (только при расширении), поиску блокировка не нужна
+    vector<pair<uint64_t, T*>> retired;
+
+    void reclaim() { // вызывается под retiredLock
+        uint64_t oldestActive = UINT64_MAX;
+        for (int i = 0; i < MAX_TABLE_THREADS; i++) {
+            uint64_t epoch = threadEpochs[i].load();
+            if (epoch != 0) oldestActive = std::min(oldestActive, epoch);
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < retired.size(); i++) {
+            if (retired[i].first < oldestActive) delete retired[i].second;
+            else retired[kept++] = retired[i];
+        }
+        retired.resize(kept);
+    }
+
+public:
+    EpochReclaimer() : globalEpoch(1) {
+        for (int i = 0; i < MAX_TABLE_THREADS; i++) threadEpochs[i].store(0);
+    }
+
+    ~EpochReclaimer() {
+        for (auto& item : retired) delete item.second;
+    }
+
+    // Охрана на время одной операции
+    class Guard {
+    private:
+        EpochReclaimer& owner;
+        int slot;
+    public:
+        explicit Guard(EpochReclaimer& owner) : owner(owner), slot(currentThreadSlot()) {
+            owner.threadEpochs[slot].store(owner.globalEpoch.load()); // seq_cst: объявление видно до чтения корня таблицы
+        }
+        ~Guard() { owner.threadEpochs[slot].store(0, memory_order_release); }
+    };
+
+    void retire(T* object) {
+        lock_guard<mutex> lock(retiredLock);
+        retired.push_back(make_pair(globalEpoch.fetch_add(1), object));
+        reclaim();
+    }
+};
+
+// Открытая адресация без блокировок для ключей и значений int. Ключ и значение лежат в
+// отдельных 64-битных атомарных словах: в слове ключа - признак занятости и ключ, в слове
+// значения - значение и признаки (нет значения, удалено, заморожено при переносе, перенесено).
+//   Поиск - только чтения, без CAS и блокировок.
+//   Вставка - CAS занимает ячейку ключа, затем CAS записывает значение.
+//   Удаление - CAS помечает значение удалённым; ячейка ключа остаётся за ключом,
+//   а место освобождается при следующем расширении.
+// Расширение: создаётся новый массив, каждая ячейка старого замораживается, переносится и
+// помечается перенесённой. Поток, встретивший замороженную ячейку, сам переносит свой ключ и
+// продолжает в новом массиве, поэтому никто не ждёт завершения всего переноса.
+// Старый массив удаляется через EpochReclaimer, когда его точно никто не читает
+class ConcurrentTable {
+private:
+    static const uint64_t KEY_USED = 1ULL << 32;
+    static const uint64_t FROZEN_EMPTY = 1ULL << 33; // пустая ячейка старого массива - ключ ищется в новом
+    static const uint64_t NEVER = 0;                  // значения никогда не было
+    static const uint64_t PRESENT = 1ULL << 32;
+    static const uint64_t TOMB = 1ULL << 33;          // было и удалено (отличается от NEVER при переносе)
+    static const uint64_t MOVED = 1ULL << 34;
+    static const uint64_t FROZEN = 1ULL << 35;        // добавляется к значению на время переноса
+
+    struct Slots {
+        int capacity;
+        unique_ptr<atomic<uint64_t>[]> keys;
+        unique_ptr<atomic<uint64_t>[]> values;
+        atomic<int> claimed; // занятые ячейки ключей, включая удалённые значения
+        atomic<Slots*> next; // новый массив, если идёт расширение
+        atomic<bool> copied; // все ячейки перенесены в next
+
+        explicit Slots(int capacity) : capacity(capacity), keys(new atomic<uint64_t>[capacity]),
+            values(new atomic<uint64_t>[capacity]), claimed(0), next(nullptr), copied(false) {
+            for (int i = 0; i < capacity; i++) {
+                keys[i].store(0, memory_order_relaxed);
+                values[i].store(NEVER, memory_order_relaxed);
+            }
+        }
+    };
+
+    atomic<Slots*> root;
+    atomic<int> size;
+    atomic<int> rehashCount;
+    double maxLoadFactor;
+    mutable EpochReclaimer<Slots> reclaimer;
+
+    static uint64_t keyWord(int key) { return KEY_USED | (uint32_t)key; }
+    static int valueOf(uint64_t word) { return (int)(uint32_t)word; }
+    static int roundCapacity(int capacity) {
+        int result = 16;
+        while (result < capacity) result *= 2;
+        return result;
+    }
+    static int home(int key, int capacity) {
+        return (int)(mixHash((size_t)(uint32_t)key) & (size_t)(capacity - 1));
+    }
+
+    // Ячейка ключа в массиве: найти или занять. -1 - массив заполнен или переносится
+    int claimSlot(Slots* a, int key) {
+        uint64_t wanted = keyWord(key);
+        int i = home(key, a->capacity);
+        for (int attempt = 0; attempt < a->capacity; attempt++) {
+            uint64_t word = a->keys[i].load(memory_order_acquire);
+            if (word == 0) {
+                if (a->claimed.load(memory_order_relaxed) + 1 > maxLoadFactor * a->capacity) return -1;
+                if (a->keys[i].compare_exchange_strong(word, wanted)) {
+                    a->claimed.fetch_add(1, memory_order_relaxed);
+                    return i;
+                }
+                // ячейку заняли раньше нас - word теперь содержит её новое состояние
+            }
+            if (word == wanted) return i;
+            if (word == FROZEN_EMPTY) return -1;
+            i = (i + 1) & (a->capacity - 1);
+        }
+        return -1;
+    }
+
+    // Вставка перенесённого значения: только если ключ в массиве ещё никогда не записывался
+    void copyInto(Slots* a, int key, int value) {
+        while (true) {
+            if (a->next.load(memory_order_acquire) != nullptr) {
+                helpCopyKey(a, key);
+                a = a->next.load(memory_order_acquire);
+                continue;
+            }
+            int i = claimSlot(a, key);
+            if (i < 0) {
+                startResize(a);
+                continue;
+            }
+            uint64_t expected = NEVER;
+            if (a->values[i].compare_exchange_strong(expected, PRESENT | (uint32_t)value)) return;
+            if ((expected & FROZEN) != 0 || expected == MOVED) continue; // массив начали переносить - повторяем в новом
+            return; // значение уже записано другим помощником или поток записал новое
+        }
+    }
+
+    // Перенос одной ячейки в следующий массив
+    void copySlot(Slots* a, int i) {
+        uint64_t word = a->keys[i].load(memory_order_acquire);
+        if (word == 0) {
+            if (a->keys[i].compare_exchange_strong(word, FROZEN_EMPTY)) return;
+        }
+        if (word == FROZEN_EMPTY) return;
+
+        uint64_t value = a->values[i].load(memory_order_acquire);
+        while ((value & FROZEN) == 0 && value != MOVED) {
+            if (a->values[i].compare_exchange_weak(value, value | FROZEN)) {
+                value |= FROZEN;
+                break;
+            }
+        }
+        if (value == MOVED) return;
+        if ((value & PRESENT) != 0) {
+            copyInto(a->next.load(memory_order_acquire), valueOf(word), valueOf(value));
+        }
+        a->values[i].store(MOVED, memory_order_release);
+    }
+
+    // Перенос ячейки, в которой лежит (или лежал бы) ключ
+    void helpCopyKey(Slots* a, int key) {
+        uint64_t wanted = keyWord(key);
+        int i = home(key, a->capacity);
+        for (int attempt = 0; attempt < a->capacity; attempt++) {
+            uint64_t word = a->keys[i].load(memory_order_acquire);
+            if (word == 0 || word == wanted) {
+                copySlot(a, i);
+                word = a->keys[i].load(memory_order_acquire);
+                if (word == FROZEN_EMPTY || word == wanted) return;
+                // пустую ячейку успел занять другой ключ - смотрим дальше
+            }
+            else if (word == FROZEN_EMPTY) {
+                return; // дальше этого места ключ не мог попасть
+            }
+            i = (i + 1) & (a->capacity - 1);
+        }
+    }
+
+    // Переключение корня на следующий массив, пока текущий полностью перенесён. Массивы снимаются
+    // строго по порядку: перенос более нового массива мог закончиться раньше предыдущего
+    void advanceRoot() {
+        while (true) {
+            Slots* current = root.load();
+            if (!current->copied.load()) return;
+            if (root.compare_exchange_strong(current, current->next.load())) {
+                rehashCount.fetch_add(1, memory_order_relaxed);
+                reclaimer.retire(current);
+            }
+        }
+    }
+
+    // Начать расширение массива (или присоединиться к начатому). Поток, создавший новый
+    // массив, переносит все ячейки и переключает корень. minCapacity - нижняя граница
+    // ёмкости нового массива (для reserve)
+    void startResize(Slots* a, int minCapacity = 0) {
+        if (a->next.load(memory_order_acquire) != nullptr) return;
+        int live = std::max(size.load(memory_order_relaxed), 0);
+        int newCapacity = std::max(a->capacity, roundCapacity((int)(live * 2 / maxLoadFactor) + 1));
+        newCapacity = std::max(newCapacity, roundCapacity(minCapacity));
+        Slots* fresh = new Slots(newCapacity);
+        Slots* expected = nullptr;
+        if (!a->next.compare_exchange_strong(expected, fresh)) {
+            delete fresh;
+            return;
+        }
+        for (int i = 0; i < a->capacity; i++) copySlot(a, i);
+        a->copied.store(true);
+        advanceRoot();
+    }
+
+public:
+    ConcurrentTable(int capacity, double maxLoadFactor = DEFAULT_OPEN_LOAD_FACTOR)
+        : root(new Slots(roundCapacity(capacity))), size(0), rehashCount(0),
+        maxLoadFactor(maxLoadFactor > 0 ? maxLoadFactor : DEFAULT_OPEN_LOAD_FACTOR) {} //без расширения CAS-таблица не работает
+
+    ~ConcurrentTable() {
+        Slots* a = root.load();
+        while (a != nullptr) {
+            Slots* next = a->next.load();
+            delete a;
+            a = next;
+        }
+    }
+
+    ConcurrentTable(const ConcurrentTable&) = delete;
+    ConcurrentTable& operator=(const ConcurrentTable&) = delete;
+
+    int getSize() const { return size.load(); }
+    int getCapacity() const {
+        EpochReclaimer<Slots>::Guard guard(reclaimer);
+        return root.load()->capacity;
+    }
+    double getLoadFactor() const { return static_cast<double>(getSize()) / getCapacity(); }
+    int getRehashCount() const { return rehashCount.load(); }
+
+    // Заранее выделить место под expectedCount элементов. Идёт через обычное расширение
+    // с переносом ячеек, поэтому безопасно и при одновременных вставках из других потоков
+    void reserve(int expectedCount) {
+        EpochReclaimer<Slots>::Guard guard(reclaimer);
+        int needed = (int)ceil((expectedCount + 1) / maxLoadFactor);
+        Slots* a = root.load();
+        while (true) {
+            Slots* next = a->next.load(memory_order_acquire);
+            if (next != nullptr) { //расширение уже идёт - смотрим на самый новый массив
+                a = next;
+                continue;
+            }
+            if (a->capacity >= needed) return;
+            startResize(a, needed);
+        }
+    }
+
+    void add(const pair<int, int>& keyValue) {
+        EpochReclaimer<Slots>::Guard guard(reclaimer);
+        Slots* a = root.load();
+        while (true) {
+            if (a->next.load(memory_order_acquire) != nullptr) {
+                helpCopyKey(a, keyValue.first);
+                a = a->next.load(memory_order_acquire);
+                continue;
+            }
+            int i = claimSlot(a, keyValue.first);
+            if (i < 0) {
+                startResize(a);
+                continue;
+            }
+            uint64_t value = a->values[i].load(memory_order_acquire);
+            while (true) {
+                if ((value & FROZEN) != 0 || value == MOVED) break; // массив переносится
+                if ((value & PRESENT) != 0) return; // дубликат
+                if (a->values[i].compare_exchange_weak(value, PRESENT | (uint32_t)keyValue.second)) {
+                    size.fetch_add(1, memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+    }
+
+    void remove(int key) {
+        EpochReclaimer<Slots>::Guard guard(reclaimer);
+        Slots* a = root.load();
+        uint64_t wanted = keyWord(key);
+        while (true) {
+            if (a->next.load(memory_order_acquire) != nullptr) {
+                helpCopyKey(a, key);
+                a = a->next.load(memory_order_acquire);
+                continue;
+            }
+            int i = home(key, a->capacity);
+            int attempt = 0;
+            for (; attempt < a->capacity; attempt++) {
+                uint64_t word = a->keys[i].load(memory_order_acquire);
+                if (word == wanted || word == 0 || word == FROZEN_EMPTY) break;
+                i = (i + 1) & (a->capacity - 1);
+            }
+            uint64_t word = attempt < a->capacity ? a->keys[i].load(memory_order_acquire) : 0;
+            if (word == FROZEN_EMPTY) continue; // следующий массив уже создан - на новом круге поможем переносу
+            if (word != wanted) return; // ключа нет
+
+            uint64_t value = a->values[i].load(memory_order_acquire);
+            while (true) {
+                if ((value & FROZEN) != 0 || value == MOVED) break;
+                if ((value & PRESENT) == 0) return; // уже удалён
+                if (a->values[i].compare_exchange_weak(value, TOMB)) {
+                    size.fetch_sub(1, memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+    }
+
+    pair<bool, int> contains(int key) const {
+        EpochReclaimer<Slots>::Guard guard(reclaimer);
+        Slots* a = root.load();
+        uint64_t wanted = keyWord(key);
+        while (a != nullptr) {
+            int i = home(key, a->capacity);
+            Slots* next = nullptr;
+            for (int attempt = 0; attempt < a->capacity; attempt++) {
+                uint64_t word = a->keys[i].load(memory_order_acquire);
+                if (word == 0) return make_pair(false, 0);
+                if (word == FROZEN_EMPTY) {
+                    next = a->next.load(memory_order_acquire);
+                    break;
+                }
+                if (word == wanted) {
+                    uint64_t value = a->values[i].load(memory_order_acquire);
+                    if (value == MOVED) {
+                        next = a->next.load(memory_order_acquire);
+                        break;
+                    }
+                    // Замороженное значение ещё актуально: писать ключ можно только после переноса
+                    if ((value & PRESENT) != 0) return make_pair(true, valueOf(value));
+                    return make_pair(false, 0);
+                }
+                i = (i + 1) & (a->capacity - 1);
+            }
+            if (next == nullptr) next = a->next.load(memory_order_acquire); //обошли весь массив
+            a = next;
+        }
+        return make_pair(false, 0);
+    }
+
+    string toString() const {
+        EpochReclaimer<Slots>::Guard guard(reclaimer);
+        Slots* a = root.load();
+        string result;
+        for (int i = 0; i < a->capacity; i++) {
+            result += "[" + to_string(i) + "]: ";
+            uint64_t word = a->keys[i].load();
+            uint64_t value = a->values[i].load();
+            if (word == 0 || word == FROZEN_EMPTY) result += "empty";
+            else if (value == MOVED) result += "moved";
+            else if ((value & PRESENT) != 0) result += "(" + to_string(valueOf(word)) + "," + to_string(valueOf(value)) + ")";
+            else result += "deleted";
+            result += "\n";
+        }
+        return result;
+    }
+};
+
+// Обычная таблица под одним мьютексом - для сравнения масштабирования по потокам
+template <typename Table>
+class LockedTable {
+private:
+    Table table;
+    mutable mutex lock;
+
+public:
+    LockedTable(int capacity) : table(capacity) {}
+
+    int getSize() const { lock_guard<mutex> guard(lock); return table.getSize(); }
+    int getCapacity() const { lock_guard<mutex> guard(lock); return table.getCapacity(); }
+    int getRehashCount() const { lock_guard<mutex> guard(lock); return table.getRehashCount(); }
+    void reserve(int expectedCount) { lock_guard<mutex> guard(lock); table.reserve(expectedCount); }
+    void add(const pair<int, int>& keyValue) { lock_guard<mutex> guard(lock); table.add(keyValue); }
+    void remove(int key) { lock_guard<mutex> guard(lock); table.remove(key); }
+    pair<bool, int> contains(int key) const { lock_guard<mutex> guard(lock); return table.contains(key); }
+    string toString() const { lock_guard<mutex> guard(lock); return table.toString(); }
+};
+
+// Прежние таблицы с ключами и значениями int - теперь частные случаи шаблонов
+typedef ChainingTable<int, int> ChainingHashTable;
+typedef ListChainingTable<int, int> ListChainingHashTable;
+typedef OpenAddressingTable<int, int> OpenAddressingHashTable;
+typedef SnapshotTable<int, int> SnapshotHashTable;
+typedef OpenAddressingTable<int, int, DefaultHash<int>, QuadraticProbing> QuadraticHashTable;
+typedef OpenAddressingTable<int, int, DefaultHash<int>, DoubleHashing> DoubleHashTable;
+typedef RobinHoodTable<int, int> RobinHoodHashTable;
+typedef CuckooTable<int, int> CuckooHashTable;
+typedef GroupedTable<int, int> GroupedHashTable;
+typedef ConcurrentTable ConcurrentHashTable;
+
+// Генератор случайных чисел
+class RandomGenerator {
+private:
+    mt19937 gen;//генератор
+    uniform_int_distribution<int> dist; //равномерное распределение
+
+public:
+    RandomGenerator(int min = 0, int max = 10000)
+        : gen(std::chrono::steady_clock::now().time_since_epoch().count()), dist(min, max) {
+    }
+
+    int generate() {
+        return dist(gen);
+    }
+
+    vector<int> generateSequence(int n) {
+        vector<int> sequence;
+        for (int i = 0; i < n; i++) {
+            sequence.push_back(generate());
+        }
+        return sequence;
+    }
+
+    // Генерация пар ключ-значение
+    vector<pair<int, int>> generateKeyValuePairs(int n) {
+        vector<pair<int, int>> pairs;
+        for (int i = 0; i < n; i++) {
+            pairs.push_back(make_pair(generate(), generate()));
+        }
+        return pairs;
+    }
+};
+
+// Функция для создания таблицы по названию во время работы программы -
+// вызовы через HashTable& компилятор уже не может сделать прямыми
+unique_ptr<HashTable> makeHashTable(const string& kind, int capacity) {
+    if (kind == "chaining") return unique_ptr<HashTable>(new VirtualHashTable<ChainingHashTable>(capacity));
+    if (kind == "open") return unique_ptr<HashTable>(new VirtualHashTable<OpenAddressingHashTable>(capacity));
+    if (kind == "concurrent") return unique_ptr<HashTable>(new VirtualHashTable<ConcurrentHashTable>(capacity));
+    throw runtime_error("Unknown table kind: " + kind);
+}
+
+// Замер вставки и rounds повторов поиска через шаблонную таблицу (статические вызовы).
+// Возвращает время в наносекундах на одну операцию
+template <typename Table>
+double timeStatic(const vector<pair<int, int>>& pairs, const vector<int>& keys, int capacity, int rounds, long long& checksum) {
+    auto start = chrono::steady_clock::now();
+    Table table(capacity);
+    for (const auto& p : pairs) table.add(p);
+    for (int r = 0; r < rounds; r++) {
+        for (int key : keys) {
+            auto result = table.contains(key);
+            if (result.first) checksum += result.second;
+        }
+    }
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(end - start).count() / (pairs.size() + (double)keys.size() * rounds);
+}
+
+// То же через указатель на базовый класс (виртуальные вызовы)
+double timeVirtual(const string& kind, const vector<pair<int, int>>& pairs, const vector<int>& keys, int capacity, int rounds, long long& checksum) {
+    auto start = chrono::steady_clock::now();
+    unique_ptr<HashTable> table = makeHashTable(kind, capacity);
+    for (const auto& p : pairs) table->add(p);
+    for (int r = 0; r < rounds; r++) {
+        for (int key : keys) {
+            auto result = table->contains(key);
+            if (result.first) checksum += result.second;
+        }
+    }
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(end - start).count() / (pairs.size() + (double)keys.size() * rounds);
+}
+
+// Гистограмма длин пробирования в виде "1:x 2:y ..." - длины от 5 собираются в группы по степеням двойки
+string probeHistogramText(const ProbeStats& stats) {
+    string result;
+    int from = 1;
+    while (from <= (int)stats.histogram.size()) {
+        int to = from < 5 ? from : (from - 1) * 2; //5-8, 9-16, 17-32, ...
+        int count = 0;
+        for (int length = from; length <= to && length <= (int)stats.histogram.size(); length++) {
+            count += stats.histogram[length - 1];
+        }
+        result += (from == to ? to_string(from) : to_string(from) + "-" + to_string(to)) + ":" + to_string(count) + " ";
+        from = to + 1;
+    }
+    return result;
+}
+
+// Строка сравнения схем пробирования: вставка и поиск всех ключей в таблице фиксированной ёмкости
+template <typename Table>
+void printProbingRow(const string& name, const vector<pair<int, int>>& pairs, const vector<int>& keys, int capacity) {
+    auto start = chrono::steady_clock::now();
+    Table table(capacity, NO_RESIZE);
+    for (const auto& p : pairs) table.add(p);
+    auto insertEnd = chrono::steady_clock::now();
+    int foundCount = 0;
+    for (int key : keys) {
+        if (table.contains(key).first) foundCount++;
+    }
+    auto searchEnd = chrono::steady_clock::now();
+
+    ProbeStats stats = table.getProbeStats();
+    cout << setw(10) << chrono::duration_cast<chrono::microseconds>(insertEnd - start).count()
+        << setw(10) << chrono::duration_cast<chrono::microseconds>(searchEnd - insertEnd).count()
+        << setw(10) << table.getLoadFactor()
+        << setw(10) << stats.mean()
+        << setw(8) << stats.maxLength
+        << setw(10) << foundCount
+        << "  " << name << ": " << probeHistogramText(stats) << "\n";
+}
+
+// Поиск всех ключей из keys; возвращает миллионы поисков в секунду, found - сколько найдено
+template <typename Table>
+double lookupRate(const Table& table, const vector<int>& keys, int& found) {
+    auto start = chrono::steady_clock::now();
+    found = 0;
+    for (int key : keys) {
+        if (table.contains(key).first) found++;
+    }
+    auto end = chrono::steady_clock::now();
+    return keys.size() / chrono::duration<double, micro>(end - start).count();
+}
+
+// Сравнение раскладки в памяти: OpenAddressingHashTable (пары + два vector<bool>) против
+// GroupedTable (байты управления + ключи + значения) при одинаковой ёмкости 2^capacityLog
+void benchmarkLayouts(int capacityLog) {
+    const int capacity = 1 << capacityLog;
+    vector<double> loadFactors = { 0.5, 0.6, 0.7, 0.8, 0.9, 0.95 };
+
+    // Различные случайные ключи: первая половина вставляется, вторая - для промахов
+    mt19937 gen(12345);
+    int maxCount = static_cast<int>(capacity * loadFactors.back());
+    vector<int> allKeys;
+    {
+        OpenAddressingTable<int, char> seen(maxCount * 2);
+        while ((int)allKeys.size() < maxCount * 2) {
+            int key = (int)gen();
+            if (seen.contains(key).first) continue;
+            seen.add(make_pair(key, (char)1));
+            allKeys.push_back(key);
+        }
+    }
+
+    cout << "Ёмкость " << capacity << ", млн поисков в секунду"
+#ifdef HASH_USE_SSE2
+        << " (группы проверяются через SSE2)"
+#endif
+        << ":\n";
+    // setw считает байты, а русские буквы в UTF-8 занимают по два - заголовок выровнен вручную
+    cout << "  Загрузка     3 вектора        группы     3 вектора        группы\n";
+    cout << "               попадания     попадания       промахи       промахи\n";
+    cout << fixed << setprecision(2);
+
+    for (double loadFactor : loadFactors) {
+        int count = static_cast<int>(capacity * loadFactor);
+        vector<int> hitKeys(allKeys.begin(), allKeys.begin() + count);
+        vector<int> missKeys(allKeys.begin() + maxCount, allKeys.begin() + maxCount + count);
+
+        OpenAddressingHashTable openTable(capacity, NO_RESIZE);
+        GroupedHashTable groupedTable(capacity, NO_RESIZE);
+        for (int i = 0; i < count; i++) {
+            openTable.add(make_pair(hitKeys[i], i));
+            groupedTable.add(make_pair(hitKeys[i], i));
+        }
+        shuffle(hitKeys.begin(), hitKeys.end(), gen); //порядок поиска не совпадает с порядком вставки
+
+        int found[4];
+        double openHit = lookupRate(openTable, hitKeys, found[0]);
+        double groupedHit = lookupRate(groupedTable, hitKeys, found[1]);
+        double openMiss = lookupRate(openTable, missKeys, found[2]);
+        double groupedMiss = lookupRate(groupedTable, missKeys, found[3]);
+        if (found[0] != count || found[1] != count || found[2] != 0 || found[3] != 0) {
+            throw runtime_error("lookup results differ from inserted keys");
+        }
+
+        cout << setw(10) << loadFactor << setw(14) << openHit << setw(14) << groupedHit
+            << setw(14) << openMiss << setw(14) << groupedMiss << "\n";
+    }
+}
+
+// ---------------- Замеры производительности (lr2n6 bench) ----------------
+// Каждый замер: прогрев, затем несколько повторов на новой таблице; по повторам берутся
+// медиана и процентили. Генераторы инициализируются фиксированным seed, поэтому ключи и
+// последовательности операций одинаковы от запуска к запуску и для всех таблиц
+
+// Сводка по повторам одного замера, в наносекундах на операцию
+struct TrialStats {
+    double median;
+    double p10;
+    double p90;
+    double min;
+};
+
+// Процентиль по отсортированным значениям (ближайший ранг)
+double percentile(const vector<double>& sorted, double fraction) {
+    size_t index = static_cast<size_t>(ceil(fraction * sorted.size()));
+    if (index > 0) index--;
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+TrialStats summarize(vector<double> samples) {
+    sort(samples.begin(), samples.end());
+    TrialStats stats;
+    stats.median = percentile(samples, 0.5);
+    stats.p10 = percentile(samples, 0.1);
+    stats.p90 = percentile(samples, 0.9);
+    stats.min = samples.front();
+    return stats;
+}
+
+// Взаимно однозначное перемешивание 32-битного числа: разные i дают разные ключи
+inline uint32_t scrambleIndex(uint32_t i, uint32_t seed) {
+    uint32_t x = i ^ seed;
+    x ^= x >> 16; x *= 0x7feb352dU;
+    x ^= x >> 15; x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
 
-    virtual void add(pair<int, int> keyValue) = 0;
-    virtual void remove(int key) = 0;
-    virtual pair<bool, int> contains(int key) = 0; // возвращает (найдено ли, значение)
-    virtual string toString() = 0;
+const vector<string> BENCH_DISTRIBUTIONS = { "uniform", "sequential", "zipf", "adversarial" };
+const vector<string> BENCH_WORKLOADS = { "insert", "hit", "miss", "mixed90", "mixed50" };
+const int ADVERSARIAL_LIMIT = 10000; // все ключи в одной ячейке дают O(n^2) - больше не берём
+const double BENCH_TIME_LIMIT_NS = 1e9; // поиски и смешанная нагрузка прерываются через секунду
 
-    int getSize() const { return size; }
-    int getCapacity() const { return capacity; }
-    double getLoadFactor() const { return static_cast<double>(size) / capacity; }
+struct BenchConfig {
+    int n;
+    int trials;
+    int warmup;
+    uint32_t seed;
 };
 
-// Узел для метода цепочек
-struct Node {
-    pair<int, int> keyValue; // пара ключ-значение
-    Node* next;
-    Node(int k, int v) : keyValue(make_pair(k, v)), next(nullptr) {}
+// Ключи для одного распределения:
+//   inserted - вставляемые, hits - порядок успешных поисков, misses - ключей нет в таблице.
+//   uniform - случайные различные ключи; sequential - 0, 1, 2, ...;
+//   zipf - ключи как в uniform, но поиски с распределением Ципфа по ним;
+//   adversarial - кратные ёмкости таблицы, при хеше key % capacity все в одной ячейке
+struct BenchKeys {
+    vector<int> inserted;
+    vector<int> hits;
+    vector<int> misses;
 };
 
-// Метод цепочек
-class ChainingHashTable : public HashTable {
-private:
-    vector<Node*> table;//вектор указателей на узлы
-
-    int hash(int key) {
-        return key % capacity;
+BenchKeys makeBenchKeys(const string& distribution, int n, int capacity, uint32_t seed) {
+    BenchKeys keys;
+    keys.inserted.resize(n);
+    keys.misses.resize(n);
+    for (int i = 0; i < n; i++) {
+        if (distribution == "sequential") {
+            keys.inserted[i] = i;
+            keys.misses[i] = n + i;
+        }
+        else if (distribution == "adversarial") {
+            keys.inserted[i] = (int)((int64_t)i * capacity);
+            keys.misses[i] = (int)((int64_t)(n + i) * capacity);
+        }
+        else {
+            keys.inserted[i] = (int)scrambleIndex(i, seed);
+            keys.misses[i] = (int)scrambleIndex(n + i, seed);
+        }
     }
 
-public:
-    ChainingHashTable(int capacity) : HashTable(capacity) {
-        table.resize(capacity, nullptr);
+    mt19937 gen(seed + 1);
+    if (distribution == "zipf") {
+        ZipfGenerator zipf(n);
+        keys.hits.resize(n);
+        for (int i = 0; i < n; i++) keys.hits[i] = keys.inserted[zipf.next(gen)];
+    }
+    else {
+        keys.hits = keys.inserted;
+        shuffle(keys.hits.begin(), keys.hits.end(), gen);
     }
+    shuffle(keys.misses.begin(), keys.misses.end(), gen);
+    return keys;
+}
 
-    ~ChainingHashTable() {
-        for (int i = 0; i < capacity; i++) {
-            Node* current = table[i];
-            while (current != nullptr) {
-                Node* temp = current;
-                current = current->next;
-                delete temp;
-            }
+// Последовательность операций смешанной нагрузки: true - запись, с долей writePercent
+vector<bool> makeWriteMask(int n, int writePercent, uint32_t seed) {
+    mt19937 gen(seed);
+    uniform_int_distribution<int> dist(0, 99);
+    vector<bool> writes(n);
+    int writeCount = 0;
+    for (int i = 0; i < n; i++) {
+        writes[i] = dist(gen) < writePercent;
+        if (writes[i]) writeCount++;
+    }
+    // Записей чётное число: каждое добавление отменяется удалением, и нагрузка не меняет таблицу
+    for (int i = n - 1; i >= 0 && writeCount % 2 != 0; i--) {
+        if (writes[i]) {
+            writes[i] = false;
+            writeCount--;
         }
     }
+    return writes;
+}
 
-    void add(pair<int, int> keyValue) override {
-        auto result = contains(keyValue.first);
-        if (result.first) return; //проверка на дубликаты
+struct BenchResult {
+    string table;
+    string distribution;
+    string workload;
+    int n;
+    int operations; // выполнено операций (меньше n, если сработал предел времени)
+    TrialStats ns;
+};
 
-        int h = hash(keyValue.first); //вычисляем хэш значение по ключу
-        Node* newNode = new Node(keyValue.first, keyValue.second); //создаём новый узел с парой ключ-значение
+// Время выполнения действия в наносекундах на операцию
+template <typename Action>
+double nanosecondsPerOp(int operations, Action action) {
+    auto start = chrono::steady_clock::now();
+    action();
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(end - start).count() / std::max(operations, 1);
+}
 
-        if (table[h] == nullptr) { //вставка в таблицу если это первый элемент в цепочке будет
-            table[h] = newNode;
-        }
-        else { //коллизия
-            Node* current = table[h]; //указывает на узел первый в цепочке, на саму ячейку
-            while (current->next != nullptr) {
-                current = current->next;//проходим до конца цепочки
-            }
-            current->next = newNode; //добавляем в конец цепочки узел новый
-        }
-        size++;
+// Операции op(0), op(1), ... op(n-1) пачками по 1024; после BENCH_TIME_LIMIT_NS цикл прерывается.
+// Так патологические случаи (промахи по длинному кластеру линейного пробирования) не тянутся часами.
+// Возвращает нс на операцию, done - сколько операций выполнено
+template <typename Op>
+double timedLoop(int n, int& done, Op op) {
+    auto start = chrono::steady_clock::now();
+    double elapsed = 0;
+    done = 0;
+    while (done < n) {
+        int end = std::min(n, done + 1024);
+        for (int i = done; i < end; i++) op(i);
+        done = end;
+        elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        if (elapsed > BENCH_TIME_LIMIT_NS) break;
     }
+    return elapsed / std::max(done, 1);
+}
 
-    void remove(int key) override { //удалить 
-        int h = hash(key);
-        Node* current = table[h];
-        Node* prev = nullptr; //для отслеживания предыдущего узла
+// Все нагрузки для одного типа таблицы. Таблица создаётся и резервируется вне замера,
+// затем в каждом повторе: вставка n ключей, поиски с попаданием, промахи, смешанные 90/10 и 50/50.
+// Запись в смешанной нагрузке - по очереди добавление и удаление ключа-промаха, размер почти не меняется
+template <typename Table>
+void benchTable(const string& tableName, const BenchConfig& config, vector<BenchResult>& results) {
+    vector<bool> writes10 = makeWriteMask(config.n, 10, config.seed + 2);
+    vector<bool> writes50 = makeWriteMask(config.n, 50, config.seed + 3);
 
-        while (current != nullptr) {
-            if (current->keyValue.first == key) {
-                if (prev == nullptr) {
-                    table[h] = current->next; //удаляем первый элемент цепочки
-                }
-                else {
-                    prev->next = current->next; //из середины или конца
-                }
-                delete current;
-                size--;
-                return;
-            }
-            prev = current;
-            current = current->next;
+    for (const string& distribution : BENCH_DISTRIBUTIONS) {
+        int n = distribution == "adversarial" ? std::min(config.n, ADVERSARIAL_LIMIT) : config.n;
+        int capacity;
+        {
+            Table probe(1);
+            probe.reserve(n);
+            capacity = probe.getCapacity();
         }
-    }
+        BenchKeys keys = makeBenchKeys(distribution, n, capacity, config.seed);
+        vector<vector<double>> samples(BENCH_WORKLOADS.size());
+        vector<int> operations(BENCH_WORKLOADS.size(), n);
+        long long checksum = 0;
 
-    pair<bool, int> contains(int key) override {//поиск - возвращает (найдено ли, значение)
-        int h = hash(key);
-        Node* current = table[h];//начало цепочки
+        for (int trial = -config.warmup; trial < config.trials; trial++) {
+            unique_ptr<Table> table(new Table(1));
+            table->reserve(n);
 
-        while (current != nullptr) {//проходим по цепочке
-            if (current->keyValue.first == key) {
-                return make_pair(true, current->keyValue.second);//нашли - возвращаем значение
+            double times[5];
+            int done[5] = { n, n, n, n, n };
+            times[0] = nanosecondsPerOp(n, [&] {
+                for (int i = 0; i < n; i++) table->add(make_pair(keys.inserted[i], i));
+                });
+            times[1] = timedLoop(n, done[1], [&](int i) { checksum += table->contains(keys.hits[i]).second; });
+            times[2] = timedLoop(n, done[2], [&](int i) { checksum += table->contains(keys.misses[i]).first; });
+            const vector<bool>* masks[2] = { &writes10, &writes50 };
+            for (int m = 0; m < 2; m++) {
+                const vector<bool>& mask = *masks[m];
+                int writeCount = 0;
+                times[3 + m] = timedLoop(n, done[3 + m], [&](int i) {
+                    if (mask[i]) {
+                        int key = keys.misses[(writeCount / 2) % n];
+                        if (writeCount % 2 == 0) table->add(make_pair(key, i));
+                        else table->remove(key);
+                        writeCount++;
+                    }
+                    else {
+                        checksum += table->contains(keys.hits[i]).second;
+                    }
+                    });
+                if (writeCount % 2 != 0) table->remove(keys.misses[(writeCount / 2) % n]); //прервались после добавления
             }
-            current = current->next;
-        }
-        return make_pair(false, -1); // не найдено
-    }
-
-    string toString() override {
-        string result;
-        for (int i = 0; i < capacity; i++) {
-            result += "[" + std::to_string(i) + "]: ";
-            Node* current = table[i];
-            while (current != nullptr) {
-                result += "(" + std::to_string(current->keyValue.first) + "," + 
-                         std::to_string(current->keyValue.second) + ") -> ";
-                current = current->next;
+            if (table->getSize() != n) {
+                throw runtime_error(tableName + ": wrong size after mixed workload");
             }
-            result += "null\n";
-        }
-        return result;
-    }
-    // Для анализа длины цепочек
-    void getChainLengths(int& minLength, int& maxLength, double& avgLength) {
-        minLength = INT_MAX;
-        maxLength = 0;
-        int totalLength = 0;
-        int nonEmptyChains = 0;
-
-        for (int i = 0; i < capacity; i++) {
-            int length = 0;
-            Node* current = table[i];
-            while (current != nullptr) {
-                length++;
-                current = current->next;
+            if (trial >= 0) {
+                for (size_t w = 0; w < BENCH_WORKLOADS.size(); w++) {
+                    samples[w].push_back(times[w]);
+                    operations[w] = std::min(operations[w], done[w]);
+                }
             }
+        }
 
-            if (length > 0) {
-                minLength = std::min(minLength, length);
-                maxLength = std::max(maxLength, length);
-                totalLength += length;
-                nonEmptyChains++;
-            }
+        for (size_t w = 0; w < BENCH_WORKLOADS.size(); w++) {
+            BenchResult result = { tableName, distribution, BENCH_WORKLOADS[w], n, operations[w], summarize(samples[w]) };
+            results.push_back(result);
+            cout << left << setw(12) << tableName << setw(13) << distribution << setw(10) << BENCH_WORKLOADS[w]
+                << right << setw(11) << n << setw(11) << operations[w] << setw(10) << result.ns.median << setw(10) << result.ns.p10
+                << setw(10) << result.ns.p90 << setw(10) << result.ns.min
+                << setw(10) << 1000.0 / result.ns.median << "\n";
         }
+        if (checksum == 42) cout << ""; //результаты поисков используются, иначе компилятор может выбросить циклы
+    }
+}
 
-        if (nonEmptyChains == 0) {
-            minLength = 0;
-            avgLength = 0;
+// Запись результатов в CSV или JSON - по расширению файла
+void writeBenchResults(const vector<BenchResult>& results, const BenchConfig& config, const string& path) {
+    bool json = path.size() >= 5 && path.substr(path.size() - 5) == ".json";
+    ostringstream out;
+    out << fixed << setprecision(3);
+    if (json) {
+        out << "{\n  \"program\": \"lr2n6\",\n  \"trials\": " << config.trials << ",\n  \"warmup\": " << config.warmup
+            << ",\n  \"seed\": " << config.seed << ",\n  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult& r = results[i];
+            out << "    {\"table\": \"" << r.table << "\", \"distribution\": \"" << r.distribution
+                << "\", \"workload\": \"" << r.workload << "\", \"n\": " << r.n << ", \"operations\": " << r.operations
+                << ", \"ns_per_op\": {\"median\": " << r.ns.median << ", \"p10\": " << r.ns.p10
+                << ", \"p90\": " << r.ns.p90 << ", \"min\": " << r.ns.min << "}"
+                << ", \"mops\": " << 1000.0 / r.ns.median << "}" << (i + 1 < results.size() ? ",\n" : "\n");
         }
-        else {
-            avgLength = static_cast<double>(totalLength) / nonEmptyChains;
+        out << "  ]\n}\n";
+    }
+    else {
+        out << "table,distribution,workload,n,operations,trials,median_ns,p10_ns,p90_ns,min_ns,mops\n";
+        for (const BenchResult& r : results) {
+            out << r.table << "," << r.distribution << "," << r.workload << "," << r.n << "," << r.operations << "," << config.trials << ","
+                << r.ns.median << "," << r.ns.p10 << "," << r.ns.p90 << "," << r.ns.min << "," << 1000.0 / r.ns.median << "\n";
         }
     }
-};
-
-// Открытая адресация
-class OpenAddressingHashTable : public HashTable {
-private:
-    vector<pair<int, int>> table; // храним пары ключ-значение
-    vector<bool> occupied; //флаги занятости ячеек
-    vector<bool> deleted; //флаг, что ячейка удалялась
 
-    int hash(int key, int attempt) {//метод линейного хэширования
-        return (key % capacity + attempt) % capacity;
+    ofstream file(path);
+    file << out.str();
+    if (!file) {
+        throw runtime_error("cannot write " + path);
     }
+}
+
+// Замер всех таблиц на всех распределениях ключей и нагрузках
+void benchmarkTables(const BenchConfig& config, const string& outputPath) {
+    cout << "N = " << config.n << ", повторов " << config.trials << " (+" << config.warmup
+        << " прогрев), seed " << config.seed << "; нс на операцию и млн операций в секунду по медиане\n";
+    cout << "table       distribution workload            n        ops    median       p10       p90       min      Mops\n";
+    cout << fixed << setprecision(1);
+
+    vector<BenchResult> results;
+    benchTable<ChainingHashTable>("chaining", config, results);
+    benchTable<OpenAddressingHashTable>("linear", config, results);
+    benchTable<QuadraticHashTable>("quadratic", config, results);
+    benchTable<DoubleHashTable>("double", config, results);
+    benchTable<RobinHoodHashTable>("robinhood", config, results);
+    benchTable<CuckooHashTable>("cuckoo", config, results);
+    benchTable<GroupedHashTable>("grouped", config, results);
+    benchTable<ConcurrentHashTable>("concurrent", config, results);
+
+    if (!outputPath.empty()) writeBenchResults(results, config, outputPath);
+}
 
+// Аппаратные счётчики процессора через perf_event_open (только Linux).
+// Каждый счётчик открывается отдельно: если какой-то не поддерживается (виртуальная машина,
+// perf_event_paranoid, другой процессор), остальные продолжают работать, а вместо него печатается "-"
+class PerfCounters {
 public:
-    OpenAddressingHashTable(int capacity) : HashTable(capacity) {
-        table.resize(capacity, make_pair(-1, -1));
-        occupied.resize(capacity, false);
-        deleted.resize(capacity, false);
+    static const int COUNT = 5;
+
+    static const char* name(int i) {
+        static const char* names[COUNT] = { "cycles", "instructions", "L1d-miss", "LLC-miss", "br-miss" };
+        return names[i];
     }
 
-    void add(pair<int, int> keyValue) override {
-        for (int attempt = 0; attempt < capacity; attempt++) {
-            int h = hash(keyValue.first, attempt);
-            if (!occupied[h] || deleted[h]) {  
-                table[h] = keyValue;
-                occupied[h] = true;
-                deleted[h] = false;
-                size++;
-                return;
-            }
-            // Если ячейка занята тем же ключом - это дубликат
-            if (occupied[h] && !deleted[h] && table[h].first == keyValue.first) {
-                return; // дубликат - не увеличиваем size
-            }
+    PerfCounters() {
+        for (int i = 0; i < COUNT; i++) {
+            fds[i] = -1;
+            values[i] = 0;
         }
-        // Таблица заполнена
-        throw std::runtime_error("Hash table is full");
+#ifdef __linux__
+        const uint32_t types[COUNT] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+        const uint64_t configs[COUNT] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+        for (int i = 0; i < COUNT; i++) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[i];
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1; //только код таблицы - так хватает perf_event_paranoid <= 2
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fds[i] < 0 && reason.empty()) reason = string("perf_event_open: ") + strerror(errno);
+        }
+#else
+        reason = "perf_event_open есть только в Linux";
+#endif
     }
 
-    void remove(int key) override {
-        for (int attempt = 0; attempt < capacity; attempt++) {
-            int h = hash(key, attempt);
-            if (!occupied[h] && !deleted[h]) {
-                return; // Элемент не найден
-            }
-            if (occupied[h] && !deleted[h] && table[h].first == key) {
-                deleted[h] = true;
-                size--;
-                return;
-            }
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int i = 0; i < COUNT; i++) {
+            if (fds[i] >= 0) close(fds[i]);
         }
+#endif
     }
 
-    pair<bool, int> contains(int key) override { //поиск элементов - возвращает (найдено ли, значение)
-        for (int attempt = 0; attempt < capacity; attempt++) {
-            int h = hash(key, attempt);
-            if (!occupied[h] && !deleted[h]) {
-                return make_pair(false, -1); //дошли до пустой ячейки - элемента нет
-            }
-            if (occupied[h] && !deleted[h] && table[h].first == key) {
-                return make_pair(true, table[h].second); // возвращаем значение
-            }
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available(int i) const { return fds[i] >= 0; }
+    bool anyAvailable() const {
+        for (int i = 0; i < COUNT; i++) if (available(i)) return true;
+        return false;
+    }
+    const string& unavailableReason() const { return reason; }
+
+    void start() {
+#ifdef __linux__
+        for (int i = 0; i < COUNT; i++) {
+            if (fds[i] < 0) continue;
+            ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
         }
-        return make_pair(false, -1);
+#endif
     }
 
-    string toString() override { //для визуального вывода таблицы
-        string result;
-        for (int i = 0; i < capacity; i++) {
-            result += "[" + to_string(i) + "]: ";
-            if (occupied[i] && !deleted[i]) {
-                result += "(" + to_string(table[i].first) + "," + to_string(table[i].second) + ")";
-            } else if (deleted[i]) {
-                result += "deleted";
-            } else {
-                result += "empty";
+    void stop() {
+#ifdef __linux__
+        for (int i = 0; i < COUNT; i++) {
+            if (fds[i] < 0) continue;
+            ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t data[3] = { 0, 0, 0 }; //значение, время включения, время работы
+            if (read(fds[i], data, sizeof(data)) != (ssize_t)sizeof(data)) {
+                values[i] = 0;
+                continue;
             }
-            result += "\n";
+            // Если счётчиков больше, чем регистров, ядро их чередует - масштабируем на полное время
+            values[i] = data[2] == 0 ? 0 : (double)data[0] * data[1] / data[2];
         }
-        return result;
+#endif
     }
-};
 
-// Генератор случайных чисел
-class RandomGenerator {
+    double value(int i) const { return values[i]; }
+
 private:
-    mt19937 gen;//генератор
-    uniform_int_distribution<int> dist; //равномерное распределение
+    int fds[COUNT];
+    double values[COUNT];
+    string reason;
+};
 
-public:
-    RandomGenerator(int min = 0, int max = 10000)
-        : gen(std::chrono::steady_clock::now().time_since_epoch().count()), dist(min, max) {
+// Один этап замера: время и счётчики на операцию
+struct PhaseCounters {
+    double nanoseconds;
+    double counters[PerfCounters::COUNT];
+};
+
+template <typename Action>
+PhaseCounters measurePhase(PerfCounters& perf, int operations, Action action) {
+    PhaseCounters result;
+    perf.start();
+    auto start = chrono::steady_clock::now();
+    action();
+    auto end = chrono::steady_clock::now();
+    perf.stop();
+    result.nanoseconds = chrono::duration<double, nano>(end - start).count() / std::max(operations, 1);
+    for (int i = 0; i < PerfCounters::COUNT; i++) {
+        result.counters[i] = perf.value(i) / std::max(operations, 1);
     }
+    return result;
+}
 
-    int generate() {
-        return dist(gen);
+void printPhase(const string& tableName, const string& phase, const PhaseCounters& result, const PerfCounters& perf) {
+    cout << left << setw(12) << tableName << setw(8) << phase << right << setw(10) << result.nanoseconds;
+    for (int i = 0; i < PerfCounters::COUNT; i++) {
+        if (perf.available(i)) cout << setw(14) << result.counters[i];
+        else cout << setw(14) << "-";
     }
+    if (perf.available(0) && perf.available(1) && result.counters[0] > 0) {
+        cout << setw(8) << result.counters[1] / result.counters[0];
+    }
+    else {
+        cout << setw(8) << "-";
+    }
+    cout << "\n";
+}
 
-    vector<int> generateSequence(int n) {
-        vector<int> sequence;
-        for (int i = 0; i < n; i++) {
-            sequence.push_back(generate());
+// Этапы insert, hit, miss, remove для одной таблицы - счётчики на операцию
+template <typename Table>
+void perfTable(const string& tableName, PerfCounters& perf, const string& distribution, int n, uint32_t seed) {
+    if (distribution == "adversarial") n = std::min(n, ADVERSARIAL_LIMIT);
+    unique_ptr<Table> table(new Table(1));
+    table->reserve(n);
+    BenchKeys keys = makeBenchKeys(distribution, n, table->getCapacity(), seed);
+    long long checksum = 0;
+
+    PhaseCounters insert = measurePhase(perf, n, [&] {
+        for (int i = 0; i < n; i++) table->add(make_pair(keys.inserted[i], i));
+        });
+    PhaseCounters hit = measurePhase(perf, n, [&] {
+        for (int key : keys.hits) checksum += table->contains(key).second;
+        });
+    PhaseCounters miss = measurePhase(perf, n, [&] {
+        for (int key : keys.misses) checksum += table->contains(key).first;
+        });
+    PhaseCounters removal = measurePhase(perf, n, [&] {
+        for (int i = 0; i < n; i++) table->remove(keys.inserted[i]);
+        });
+    if (table->getSize() != 0) {
+        throw runtime_error(tableName + ": table is not empty after removing all keys");
+    }
+
+    printPhase(tableName, "insert", insert, perf);
+    printPhase(tableName, "hit", hit, perf);
+    printPhase(tableName, "miss", miss, perf);
+    printPhase(tableName, "remove", removal, perf);
+    if (checksum == 42) cout << "";
+}
+
+// Замер со счётчиками: объясняет разницу во времени (промахи кэша, ошибки предсказания переходов)
+void benchmarkCounters(int n, const string& distribution) {
+    if (find(BENCH_DISTRIBUTIONS.begin(), BENCH_DISTRIBUTIONS.end(), distribution) == BENCH_DISTRIBUTIONS.end()) {
+        throw runtime_error("Unknown distribution: " + distribution);
+    }
+    PerfCounters perf;
+    cout << "N = " << n << ", ключи " << distribution << "; время и счётчики на одну операцию\n";
+    if (!perf.anyAvailable()) {
+        cout << "Аппаратные счётчики недоступны (" << perf.unavailableReason() << ") - печатается только время\n";
+    }
+    cout << "table       phase      ns/op";
+    for (int i = 0; i < PerfCounters::COUNT; i++) cout << setw(14) << PerfCounters::name(i);
+    cout << "     IPC\n";
+    cout << fixed << setprecision(2);
+
+    const uint32_t seed = 20240601;
+    perfTable<ChainingHashTable>("chaining", perf, distribution, n, seed);
+    perfTable<OpenAddressingHashTable>("linear", perf, distribution, n, seed);
+    perfTable<QuadraticHashTable>("quadratic", perf, distribution, n, seed);
+    perfTable<DoubleHashTable>("double", perf, distribution, n, seed);
+    perfTable<RobinHoodHashTable>("robinhood", perf, distribution, n, seed);
+    perfTable<CuckooHashTable>("cuckoo", perf, distribution, n, seed);
+    perfTable<GroupedHashTable>("grouped", perf, distribution, n, seed);
+}
+
+// Многопоточный замер: таблица заполняется n ключами, затем threads потоков одновременно
+// выполняют opsPerThread операций: чтение существующего ключа или (с долей 100 - readPercent)
+// запись - по очереди добавление и удаление собственного ключа потока, размер таблицы не меняется.
+// Возвращает миллионы операций в секунду на все потоки
+template <typename Table>
+double threadedRate(const BenchKeys& keys, int threads, int opsPerThread, int readPercent, uint32_t seed) {
+    int n = (int)keys.inserted.size();
+    unique_ptr<Table> table(new Table(1));
+    table->reserve(n + threads);
+    for (int i = 0; i < n; i++) table->add(make_pair(keys.inserted[i], i));
+
+    atomic<int> ready(0);
+    atomic<bool> go(false);
+    atomic<long long> checksum(0);
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            mt19937 gen(seed + t);
+            uniform_int_distribution<int> pick(0, n - 1);
+            uniform_int_distribution<int> percent(0, 99);
+            // Ключи записи у каждого потока свои - из промахов, по 64 на поток
+            int ownBase = (t * 64) % std::max((int)keys.misses.size() - 64, 1);
+            long long local = 0;
+            int writes = 0;
+            ready.fetch_add(1);
+            while (!go.load()) this_thread::yield();
+            for (int i = 0; i < opsPerThread; i++) {
+                if (percent(gen) < readPercent) {
+                    local += table->contains(keys.inserted[pick(gen)]).second;
+                }
+                else {
+                    int key = keys.misses[ownBase + (writes / 2) % 64];
+                    if (writes % 2 == 0) table->add(make_pair(key, i));
+                    else table->remove(key);
+                    writes++;
+                }
+            }
+            if (writes % 2 != 0) table->remove(keys.misses[ownBase + (writes / 2) % 64]);
+            checksum.fetch_add(local);
+            });
+    }
+    while (ready.load() < threads) this_thread::yield();
+    auto start = chrono::steady_clock::now();
+    go.store(true);
+    for (auto& worker : workers) worker.join();
+    auto end = chrono::steady_clock::now();
+
+    if (table->getSize() != n) {
+        throw runtime_error("wrong size after threaded workload");
+    }
+    for (int i = 0; i < n; i += std::max(n / 1000, 1)) {
+        if (!table->contains(keys.inserted[i]).first) throw runtime_error("key lost in threaded workload");
+    }
+    return (double)threads * opsPerThread / chrono::duration<double, micro>(end - start).count();
+}
+
+// Масштабирование по числу потоков 1, 2, 4, ... maxThreads: таблица без блокировок
+// против обычных таблиц под одним мьютексом
+void benchmarkThreads(int n, int maxThreads, const vector<int>& readPercents) {
+    const uint32_t seed = 20240601;
+    const int opsPerThread = 1000000;
+    BenchKeys keys = makeBenchKeys("uniform", n, 0, seed);
+    if ((int)keys.misses.size() < maxThreads * 64) {
+        // для маленьких n дополняем ключи записи, чтобы у каждого потока были свои
+        for (int i = (int)keys.misses.size(); i < maxThreads * 64 + 64; i++) keys.misses.push_back((int)scrambleIndex(n + i, seed));
+    }
+
+    vector<int> threadCounts;
+    for (int t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+
+    cout << "N = " << n << ", " << opsPerThread << " операций на поток, процессоров: "
+        << thread::hardware_concurrency() << "; млн операций в секунду на все потоки\n";
+    cout << "reads%  threads    concurrent  mutex+chaining  mutex+grouped\n";
+    cout << fixed << setprecision(2);
+    for (int readPercent : readPercents) {
+        for (int threads : threadCounts) {
+            cout << setw(6) << readPercent << setw(9) << threads
+                << setw(14) << threadedRate<ConcurrentHashTable>(keys, threads, opsPerThread, readPercent, seed)
+                << setw(16) << threadedRate<LockedTable<ChainingHashTable>>(keys, threads, opsPerThread, readPercent, seed)
+                << setw(15) << threadedRate<LockedTable<GroupedHashTable>>(keys, threads, opsPerThread, readPercent, seed) << "\n";
         }
-        return sequence;
     }
+}
 
-    // Генерация пар ключ-значение
-    vector<pair<int, int>> generateKeyValuePairs(int n) {
-        vector<pair<int, int>> pairs;
-        for (int i = 0; i < n; i++) {
-            pairs.push_back(make_pair(generate(), generate()));
+// Вставка n ключей, поиск, удаление половины и уничтожение таблицы - время и прирост RSS
+template <typename Table>
+void nodeBenchRow(const string& name, const BenchKeys& keys, int capacity, double maxLoadFactor) {
+    int n = (int)keys.inserted.size();
+    releaseFreeMemory();
+    size_t rssBefore = residentBytes();
+    long long checksum = 0;
+
+    unique_ptr<Table> table(new Table(capacity, maxLoadFactor));
+    double insertNs = nanosecondsPerOp(n, [&] {
+        for (int i = 0; i < n; i++) table->add(make_pair(keys.inserted[i], i));
+        });
+    size_t rssAfter = residentBytes();
+    double hitNs = nanosecondsPerOp(n, [&] {
+        for (int key : keys.hits) checksum += table->contains(key).second;
+        });
+    double churnNs = nanosecondsPerOp(n, [&] { //удаление и повторная вставка - узлы переиспользуются
+        for (int i = 0; i < n; i += 2) table->remove(keys.inserted[i]);
+        for (int i = 0; i < n; i += 2) table->add(make_pair(keys.inserted[i], i));
+        });
+    double destroyMs = nanosecondsPerOp(1, [&] { table.reset(); }) / 1e6;
+    if (checksum == 42) cout << "";
+
+    cout << setw(12) << 1000.0 / insertNs << setw(12) << 1000.0 / hitNs << setw(12) << 1000.0 / churnNs
+        << setw(12) << destroyMs;
+    if (rssBefore != 0) cout << setw(12) << ((double)rssAfter - (double)rssBefore) / (1 << 20); //RSS мог и уменьшиться
+    else cout << setw(12) << "-";
+    cout << "  " << name << "\n";
+}
+
+// Сравнение цепочек: прежние узлы через new против пула узлов и элементов внутри ячеек
+void benchmarkNodes(int n) {
+    BenchKeys keys = makeBenchKeys("uniform", n, 0, 20240601);
+    cout << "N = " << n << "; вставка, поиск и удаление+вставка - млн операций в секунду\n";
+    cout << "  вставка       поиск   удал+вст  уничт, мс    RSS+, МБ  таблица\n";
+    cout << fixed << setprecision(2);
+    cout << "Ёмкость растёт от N/10 (заполнение до " << DEFAULT_CHAIN_LOAD_FACTOR << "):\n";
+    nodeBenchRow<ListChainingHashTable>("new на узел, вставка в конец", keys, std::max(n / 10, 1), DEFAULT_CHAIN_LOAD_FACTOR);
+    nodeBenchRow<ChainingHashTable>("пул узлов, " + to_string(CHAIN_INLINE) + " элемента в ячейке", keys, std::max(n / 10, 1), DEFAULT_CHAIN_LOAD_FACTOR);
+    cout << "Ёмкость N/10 без расширения (цепочки около 10, как в задании):\n";
+    nodeBenchRow<ListChainingHashTable>("new на узел, вставка в конец", keys, std::max(n / 10, 1), NO_RESIZE);
+    nodeBenchRow<ChainingHashTable>("пул узлов, " + to_string(CHAIN_INLINE) + " элемента в ячейке", keys, std::max(n / 10, 1), NO_RESIZE);
+}
+
+// Поиск всех ключей по одному и пакетами разного размера; результаты пакетов сверяются с поштучными
+template <typename Table>
+void batchBenchRow(const string& name, const Table& table, const vector<int>& keys, const vector<int>& batchSizes) {
+    vector<pair<bool, int>> expected(keys.size());
+    double scalarNs = nanosecondsPerOp(keys.size(), [&] {
+        for (size_t i = 0; i < keys.size(); i++) expected[i] = table.contains(keys[i]);
+        });
+    cout << setw(12) << 1000.0 / scalarNs;
+
+    vector<pair<bool, int>> results;
+    for (int batchSize : batchSizes) {
+        vector<vector<int>> batches; //разбиение на пакеты - вне замера
+        for (size_t start = 0; start < keys.size(); start += batchSize) {
+            batches.emplace_back(keys.begin() + start, keys.begin() + std::min(keys.size(), start + batchSize));
         }
-        return pairs;
+        long long mismatches = 0;
+        double batchNs = nanosecondsPerOp(keys.size(), [&] {
+            size_t start = 0;
+            for (const vector<int>& batch : batches) {
+                table.containsBatch(batch, results);
+                for (size_t i = 0; i < batch.size(); i++) mismatches += results[i] != expected[start + i];
+                start += batch.size();
+            }
+            });
+        if (mismatches != 0) throw runtime_error("containsBatch differs from contains in " + name);
+        cout << setw(12) << 1000.0 / batchNs;
     }
-};
+    cout << "  " << name << "\n";
+}
+
+// Пакетный поиск с предвыборкой против обычного цикла contains. Выигрыш заметен, когда
+// таблица не помещается в кэш последнего уровня: по умолчанию N = 2^24 (сотни МБ)
+void benchmarkBatch(int n) {
+    BenchKeys keys = makeBenchKeys("uniform", n, 0, 20240601);
+    vector<int> batchSizes = { BATCH_GROUP, 256, 4096 };
+    ChainingHashTable chaining(n, DEFAULT_CHAIN_LOAD_FACTOR);
+    OpenAddressingHashTable open(n, DEFAULT_OPEN_LOAD_FACTOR);
+    for (int i = 0; i < n; i++) {
+        chaining.add(make_pair(keys.inserted[i], i));
+        open.add(make_pair(keys.inserted[i], i));
+    }
+
+    cout << "N = " << n << "; млн поисков в секунду, пакеты обрабатываются группами по " << BATCH_GROUP << " ключей\n";
+    cout << "Цепочки: " << chaining.getMemoryBytes() / (1 << 20) << " МБ; открытая адресация: "
+        << (size_t)open.getCapacity() * sizeof(pair<int, int>) / (1 << 20) << " МБ\n";
+    cout << "   по одному";
+    for (int batchSize : batchSizes) cout << "  пакет " << setw(4) << batchSize;
+    cout << "\n" << fixed << setprecision(2);
+    batchBenchRow("цепочки, ключи есть", chaining, keys.hits, batchSizes);
+    batchBenchRow("цепочки, ключей нет", chaining, keys.misses, batchSizes);
+    batchBenchRow("линейное пробирование, ключи есть", open, keys.hits, batchSizes);
+    batchBenchRow("линейное пробирование, ключей нет", open, keys.misses, batchSizes);
+}
+
+// Вытеснить файл из страничного кэша, чтобы следующее открытие читало его с диска (Linux)
+bool dropFileCache(const string& path) {
+#ifdef __linux__
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool dropped = fdatasync(fd) == 0 && posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return dropped;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+// Открытие снимка и поиск: время открытия, первого поиска и скорость последующих
+void snapshotBenchRow(const string& name, const string& path, bool verifyChecksum, const BenchKeys& keys, long long expectedSum) {
+    unique_ptr<SnapshotHashTable> snapshot;
+    double openNs = nanosecondsPerOp(1, [&] { snapshot.reset(new SnapshotHashTable(path, verifyChecksum)); });
+    pair<bool, int> first;
+    double firstNs = nanosecondsPerOp(1, [&] { first = snapshot->contains(keys.hits[0]); });
+    long long sum = 0;
+    int falseHits = 0;
+    double hitNs = nanosecondsPerOp(keys.hits.size(), [&] {
+        for (int key : keys.hits) sum += snapshot->contains(key).second;
+        });
+    for (int key : keys.misses) falseHits += snapshot->contains(key).first;
+    if (!first.first || sum != expectedSum || falseHits != 0) throw runtime_error("Snapshot lookups differ from the table");
+    cout << setw(12) << openNs / 1e6 << setw(12) << firstNs / 1e3 << setw(12) << 1000.0 / hitNs << "  " << name << "\n";
+}
+
+// Сохранение таблицы с открытой адресацией в снимок и открытие его вместо перестроения
+void benchmarkSnapshot(int n, const string& path) {
+    BenchKeys keys = makeBenchKeys("uniform", n, 0, 20240601);
+    long long expectedSum = 0;
+    unique_ptr<OpenAddressingHashTable> table(new OpenAddressingHashTable(16));
+    double buildNs = nanosecondsPerOp(1, [&] {
+        for (int i = 0; i < n; i++) table->add(make_pair(keys.inserted[i], i));
+        });
+    for (int key : keys.hits) expectedSum += table->contains(key).second;
+    double saveNs = nanosecondsPerOp(1, [&] { table->saveSnapshot(path); });
+    table.reset(); //дальше работает только снимок, как в новом процессе
+
+    cout << fixed << setprecision(2);
+    cout << "N = " << n << "; файл " << path << "\n";
+    cout << "Построение таблицы: " << buildNs / 1e6 << " мс; запись снимка: " << saveNs / 1e6 << " мс\n";
+    cout << "Открытие снимка в мс, первый поиск в мкс, остальные - млн поисков в секунду:\n";
+    cout << "    открытие   1-й поиск       поиск  снимок\n";
+    if (dropFileCache(path)) snapshotBenchRow("файл вытеснен из кэша ОС", path, false, keys, expectedSum);
+    snapshotBenchRow("файл в кэше ОС", path, false, keys, expectedSum);
+    snapshotBenchRow("файл в кэше ОС, с проверкой контрольной суммы", path, true, keys, expectedSum);
+}
 
 // Функции для выполнения заданий
 void task1() {
@@ -299,7 +2956,7 @@ void task1() {
     cout << "МЕТОД ЦЕПОЧЕК:\n";
     auto start = chrono::high_resolution_clock::now(); //начинаем отсчёт времени
 
-    ChainingHashTable chainTable(capacity); //создаём таблицу
+    ChainingHashTable chainTable(capacity, NO_RESIZE); //создаём таблицу фиксированного размера
     for (const auto& pair : pairs) {//заполняем парами
         chainTable.add(pair);
     }
@@ -338,7 +2995,7 @@ void task1() {
     cout << "Емкость таблицы (меняем так как в этом методе нельзя вставить больше элементов): " << capacityForOpen << endl;
     start = chrono::high_resolution_clock::now(); //перезаписываем время начала 
 
-    OpenAddressingHashTable openTable(capacityForOpen);
+    OpenAddressingHashTable openTable(capacityForOpen, NO_RESIZE);
     for (const auto& pair : pairs) {
         openTable.add(pair);
     }
@@ -363,7 +3020,51 @@ void task1() {
     cout << "Время вставки " << N << " элементов: " << insertTime.count() << " мкс\n";
     cout << "Время выполнения " << M << " поисков: " << searchTime.count() << " мкс\n";
     cout << "Найдено элементов: " << foundCount << "/" << M << "\n";
-    cout << "Сумма найденных значений: " << totalValue << "\n";
+    cout << "Сумма найденных значений: " << totalValue << "\n\n";
+
+    // Шаблонные таблицы против вызовов через HashTable& (поиск повторяем, чтобы время было заметным)
+    cout << "СТАТИЧЕСКИЕ И ВИРТУАЛЬНЫЕ ВЫЗОВЫ (нс на операцию):\n";
+    const int rounds = 20000;
+    long long checksumStatic = 0, checksumVirtual = 0;
+    double chainStatic = timeStatic<ChainingHashTable>(pairs, searchKeys, capacity, rounds, checksumStatic);
+    double chainVirtual = timeVirtual("chaining", pairs, searchKeys, capacity, rounds, checksumVirtual);
+    double openStatic = timeStatic<OpenAddressingHashTable>(pairs, searchKeys, capacityForOpen, rounds, checksumStatic);
+    double openVirtual = timeVirtual("open", pairs, searchKeys, capacityForOpen, rounds, checksumVirtual);
+    cout << "Метод цепочек:      шаблон " << chainStatic << ", virtual " << chainVirtual << "\n";
+    cout << "Открытая адресация: шаблон " << openStatic << ", virtual " << openVirtual << "\n";
+    cout << "Контрольные суммы " << (checksumStatic == checksumVirtual ? "совпадают" : "НЕ совпадают") << "\n\n";
+
+    // Сравнение схем открытой адресации. Ёмкость - степень двойки, чтобы квадратичное
+    // пробирование обходило все ячейки. Кукушке при такой загрузке
+    // двух ячеек на ключ не хватает, и она увеличивает таблицу
+    cout << "СХЕМЫ ПРОБИРОВАНИЯ (время в мкс, длина успешного поиска в пробах):\n";
+    const int probeCapacity = 16384;
+    RandomGenerator wideRng(INT_MIN, INT_MAX);
+    vector<pair<string, vector<pair<int, int>>>> workloads = {
+        { "ключи 0..10000 как в задании, 20000 вставок", rng.generateKeyValuePairs(20000) },
+        { "ключи во всём диапазоне int, 12000 вставок", wideRng.generateKeyValuePairs(12000) }
+    };
+    for (const auto& workload : workloads) {
+        vector<int> keys;
+        for (const auto& p : workload.second) keys.push_back(p.first);
+        cout << workload.first << "\n";
+        cout << setw(10) << "Вставка" << setw(10) << "Поиск" << setw(10) << "Загрузка"
+            << setw(10) << "Средняя" << setw(8) << "Макс" << setw(10) << "Найдено" << "  Гистограмма\n";
+        printProbingRow<OpenAddressingHashTable>("линейное", workload.second, keys, probeCapacity);
+        printProbingRow<QuadraticHashTable>("квадратичное", workload.second, keys, probeCapacity);
+        printProbingRow<DoubleHashTable>("двойное хеширование", workload.second, keys, probeCapacity);
+        printProbingRow<RobinHoodHashTable>("Robin Hood", workload.second, keys, probeCapacity);
+        printProbingRow<CuckooHashTable>("кукушка", workload.second, keys, probeCapacity);
+    }
+    cout << "\n";
+
+    // Шаблоны позволяют хранить и другие типы ключей и значений
+    ChainingTable<uint64_t, string> idTable(16);
+    idTable.add(make_pair(9000000000000000001ULL, string("user")));
+    OpenAddressingTable<string, int> nameTable(16);
+    nameTable.add(make_pair(string("alpha"), 1));
+    cout << "64-битный ключ: " << idTable.contains(9000000000000000001ULL).second
+        << ", строковый ключ: " << nameTable.contains("alpha").second << "\n";
 }
 
 void task2() {
@@ -373,8 +3074,9 @@ void task2() {
 
     cout << setw(8) << "N" << setw(12) << "Емкость"
         << setw(10) << "Мин" << setw(10) << "Макс" 
-        << setw(15) << "Время вставки" << setw(15) << "Сумма значений\n";
-    cout << string(85, '-') << "\n";
+        << setw(15) << "Время вставки" << setw(15) << "Сумма значений"
+        << setw(16) << "Шаблон, нс/оп" << setw(16) << "virtual, нс/оп\n";
+    cout << string(117, '-') << "\n";
 
     for (int N : testSizes) { //цикл тестирование вставки
         int capacity = N / 10; //размер таблицы
@@ -388,7 +3090,7 @@ void task2() {
 
         auto start = std::chrono::high_resolution_clock::now();
 
-        ChainingHashTable table(capacity);
+        ChainingHashTable table(capacity, NO_RESIZE); //ёмкость фиксирована, как в задании
         for (const auto& pair : pairs) {//добавляем пары
             table.add(pair);
         }
@@ -409,17 +3111,157 @@ void task2() {
         double avgLen; //средняя длина непустых цепочек
         table.getChainLengths(minLen, maxLen, avgLen);
 
+        long long checksum = 0;
+        double staticTime = timeStatic<ChainingHashTable>(pairs, searchKeys, capacity, 5, checksum);
+        double virtualTime = timeVirtual("chaining", pairs, searchKeys, capacity, 5, checksum);
+
         cout << setw(8) << N
             << setw(12) << capacity
             << setw(10) << minLen
             << setw(10) << maxLen
             << setw(10) << time.count() << " мкс"
-            << setw(15) << totalValue << "\n";
+            << setw(15) << totalValue
+            << setw(16) << staticTime
+            << setw(16) << virtualTime << "\n";
+    }
+
+    // То же с автоматическим расширением: начальная ёмкость N/10, таблица растёт сама.
+    // "reserve" - ёмкость выделена заранее по ожидаемому числу элементов
+    cout << "\nС автоматическим расширением (порог заполнения: цепочки "
+        << DEFAULT_CHAIN_LOAD_FACTOR << ", открытая адресация " << DEFAULT_OPEN_LOAD_FACTOR << "):\n";
+    cout << setw(8) << "N" << setw(12) << "Емкость" << setw(14) << "Перестроений"
+        << setw(8) << "Мин" << setw(8) << "Макс" << setw(10) << "Средняя"
+        << setw(18) << "Время вставки" << "  Таблица\n";
+    cout << string(100, '-') << "\n";
+
+    for (int N : testSizes) {
+        auto pairs = rng.generateKeyValuePairs(N);
+
+        for (int variant = 0; variant < 3; variant++) {
+            int minLen = 0, maxLen = 0;
+            double avgLen = 0;
+            int capacity = 0, rehashes = 0;
+            string name;
+
+            auto start = chrono::high_resolution_clock::now();
+            if (variant < 2) {
+                ChainingHashTable table(N / 10);
+                if (variant == 1) table.reserve(N);
+                for (const auto& pair : pairs) table.add(pair);
+                table.getChainLengths(minLen, maxLen, avgLen);
+                capacity = table.getCapacity();
+                rehashes = table.getRehashCount();
+                name = variant == 0 ? "цепочки" : "цепочки, reserve";
+            }
+            else {
+                OpenAddressingHashTable table(N / 10); //без расширения здесь было бы "Hash table is full"
+                for (const auto& pair : pairs) table.add(pair);
+                capacity = table.getCapacity();
+                rehashes = table.getRehashCount();
+                name = "открытая адресация";
+            }
+            auto end = chrono::high_resolution_clock::now();
+            auto time = chrono::duration_cast<chrono::microseconds>(end - start);
+
+            cout << setw(8) << N << setw(12) << capacity << setw(14) << rehashes;
+            if (variant < 2) {
+                cout << setw(8) << minLen << setw(8) << maxLen << setw(10) << avgLen;
+            }
+            else {
+                cout << setw(8) << "-" << setw(8) << "-" << setw(10) << "-";
+            }
+            cout << setw(14) << time.count() << " мкс  " << name << "\n";
+        }
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     setlocale(LC_ALL, "RU");
+
+    // Без аргументов - задания 1 и 2. Замеры:
+    //   lr2n6 bench [N] [повторы] [файл .csv или .json] - все таблицы, распределения ключей и нагрузки
+    //   lr2n6 layoutbench [log2 ёмкости] - раскладка открытой адресации в памяти
+    //   lr2n6 perf [N] [распределение] - аппаратные счётчики по этапам (Linux)
+    //   lr2n6 mtbench [N] [потоки] [доля чтений %] - масштабирование по потокам
+    //   lr2n6 nodebench [N] - пул узлов метода цепочек: скорость вставки и память
+    //   lr2n6 batchbench [N] - пакетный поиск с предвыборкой против поиска по одному ключу
+    //   lr2n6 snapbench [N] [файл] - снимок таблицы в файле: запись, открытие и первый поиск
+    if (argc > 1) {
+        string command = argv[1];
+        bool known = (command == "bench" && argc <= 5)
+            || (command == "nodebench" && argc <= 3)
+            || (command == "batchbench" && argc <= 3)
+            || (command == "snapbench" && argc <= 4)
+            || (command == "mtbench" && argc <= 5)
+            || (command == "layoutbench" && argc <= 3)
+            || (command == "perf" && argc <= 4);
+        if (!known) {
+            cerr << "Использование:\n"
+                << "  " << argv[0] << "\n"
+                << "  " << argv[0] << " bench [N] [повторы] [файл .csv или .json]\n"
+                << "  " << argv[0] << " layoutbench [log2 ёмкости]\n"
+                << "  " << argv[0] << " perf [N] [uniform|sequential|zipf|adversarial]\n"
+                << "  " << argv[0] << " mtbench [N] [потоки] [доля чтений %]\n"
+                << "  " << argv[0] << " nodebench [N]\n"
+                << "  " << argv[0] << " batchbench [N]\n"
+                << "  " << argv[0] << " snapbench [N] [файл]" << endl;
+            return 1;
+        }
+        try {
+            if (command == "bench") {
+                BenchConfig config;
+                config.n = argc >= 3 ? stoi(argv[2]) : 1000000;
+                config.trials = argc >= 4 ? stoi(argv[3]) : 5;
+                config.warmup = 1;
+                config.seed = 20240601;
+                if (config.n < 1 || config.n > 100000000 || config.trials < 1) {
+                    throw runtime_error("N must be 1..10^8 and trials at least 1");
+                }
+                benchmarkTables(config, argc == 5 ? argv[4] : "");
+            }
+            else if (command == "nodebench") {
+                int n = argc == 3 ? stoi(argv[2]) : 1000000;
+                if (n < 1 || n > 100000000) throw runtime_error("N must be 1..10^8");
+                benchmarkNodes(n);
+            }
+            else if (command == "batchbench") {
+                int n = argc == 3 ? stoi(argv[2]) : 1 << 24;
+                if (n < 1 || n > 100000000) throw runtime_error("N must be 1..10^8");
+                benchmarkBatch(n);
+            }
+            else if (command == "snapbench") {
+                int n = argc >= 3 ? stoi(argv[2]) : 10000000;
+                if (n < 1 || n > 100000000) throw runtime_error("N must be 1..10^8");
+                string path = argc == 4 ? argv[3] : "lr2n6.snapshot";
+                benchmarkSnapshot(n, path);
+                if (argc < 4) std::remove(path.c_str()); //файл по умолчанию не оставляем
+            }
+            else if (command == "mtbench") {
+                int n = argc >= 3 ? stoi(argv[2]) : 1000000;
+                int threads = argc >= 4 ? stoi(argv[3]) : (int)std::max(thread::hardware_concurrency(), 1u);
+                vector<int> readPercents = { 100, 90, 50 };
+                if (argc == 5) readPercents = { stoi(argv[4]) };
+                if (n < 1 || threads < 1 || threads >= MAX_TABLE_THREADS || readPercents[0] < 0 || readPercents[0] > 100) {
+                    throw runtime_error("N must be positive, threads 1.." + to_string(MAX_TABLE_THREADS - 1) + ", reads 0..100");
+                }
+                benchmarkThreads(n, threads, readPercents);
+            }
+            else if (command == "perf") {
+                int n = argc >= 3 ? stoi(argv[2]) : 1000000;
+                if (n < 1 || n > 100000000) throw runtime_error("N must be 1..10^8");
+                benchmarkCounters(n, argc == 4 ? argv[3] : "uniform");
+            }
+            else {
+                benchmarkLayouts(argc == 3 ? stoi(argv[2]) : 20);
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
     try {
         task1();
         cout << "\n\n";
@@ -2,8 +2,55 @@
 #include <string>
 #include <algorithm>
 #include <unordered_map>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iomanip>
+#include <stdexcept>
+#include <fstream>
+#include <cstdlib>
+#include <new>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <cerrno>
+#include <cctype>
+#include <cstdint>
+#include "LRUCache.h"
+#include "CachePolicies.h"
+#include "WorkloadBench.h"
 using namespace std;
 
+// Счётчик выделений памяти через new во всей программе - для замера lr2n7 membench.
+// new вызывают и потоки шардированного кэша, поэтому счётчик атомарный; порядок
+// не нужен, только итоговое число
+static atomic<size_t> allocationCount(0);
+
+// Замены new/delete не встраиваются: иначе GCC видит в одном месте malloc, а в другом
+// operator delete (или наоборот) и ошибочно предупреждает о несовпадении пары
+#if defined(__GNUC__) || defined(__clang__)
+#define LR2N7_NOINLINE __attribute__((noinline))
+#else
+#define LR2N7_NOINLINE
+#endif
+
+LR2N7_NOINLINE void* operator new(size_t size) {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    if (void* memory = malloc(size == 0 ? 1 : size)) return memory;
+    throw bad_alloc();
+}
+
+LR2N7_NOINLINE void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+LR2N7_NOINLINE void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
 struct DNode {// Узел для двусвязного списка LRU (должен хранить и ключ, и значение)
     int key;
     int value;
@@ -93,6 +140,8 @@ struct DList { // Двусвязный список для LRU
     }
 };
 
+// Исходная реализация: после каждой операции печатает весь список, то есть работает за O(ёмкость).
+// Оставлена для сравнения с LRUCache из LRUCache.h (lr2n7 bench)
 class LRUcache {
 private:
     int capacity;
@@ -147,8 +196,542 @@ public:
     }
 };
 
-int main() {
-    setlocale(LC_ALL, "RU");
+// Трассировка для диалогового режима: сообщает о вытеснении, как раньше делал LRUcache::SET
+struct ConsoleLRUTrace : NoLRUTrace {
+    void onEvict(int key, int value) {
+        cout << "Удаляем самый старый: (" << key << ":" << value << ")" << endl;
+    }
+};
+
+typedef LRUCache<int, int, hash<int>, ConsoleLRUTrace> ConsoleLRUCache;
+
+void printOrder(const ConsoleLRUCache& cache) {
+    cout << "LRU порядок: ";
+    cache.forEach([](int key, int value) { cout << "(" << key << ":" << value << ") "; });
+    cout << endl;
+}
+
+// Поток вывода, который всё выбрасывает: печать старой реализации в замере не видна,
+// но форматирование списка по-прежнему выполняется
+struct NullBuffer : streambuf {
+    int overflow(int c) override { return c; }
+};
+
+const double BENCH_TIME_LIMIT_S = 2.0; //старая реализация на больших ёмкостях дальше не ждём
+
+// Прогон последовательности запросов "GET, при промахе SET" с ограничением по времени.
+// Возвращает, сколько запросов выполнено и за сколько секунд; hits - число попаданий
+template <typename Lookup>
+pair<size_t, double> runRequests(const vector<int>& requests, size_t& hits, Lookup lookup) {
+    auto start = chrono::steady_clock::now();
+    double seconds = 0;
+    size_t done = 0;
+    hits = 0;
+    while (done < requests.size()) {
+        hits += lookup(requests[done]);
+        done++;
+        if (done % 256 == 0) {
+            seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (seconds > BENCH_TIME_LIMIT_S) return make_pair(done, seconds);
+        }
+    }
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return make_pair(done, seconds);
+}
+
+// Сравнение LRUcache и LRUCache: сначала capacity разных ключей заполняют кэш, затем
+// столько же (но не меньше 10^6) запросов к ключам из диапазона [0, 2 * capacity)
+void benchmarkCaches(int maxCapacity) {
+    cout << "Запросы: GET, при промахе SET; млн запросов в секунду\n";
+    cout << "     ёмкость     запросов     LRUcache    LRUCache  FixedLRUCache  попадания  выполнено LRUcache\n";
+    cout << fixed << setprecision(3);
+    for (int capacity = 1000; capacity <= maxCapacity; capacity *= 10) {
+        mt19937 generator(20240601);
+        uniform_int_distribution<int> keyDistribution(0, 2 * capacity - 1);
+        vector<int> requests;
+        requests.reserve(capacity + std::max(capacity, 1000000));
+        for (int i = 0; i < capacity; i++) requests.push_back(i);
+        for (int i = 0; i < std::max(capacity, 1000000); i++) requests.push_back(keyDistribution(generator));
+
+        size_t oldHits = 0, newHits = 0;
+        pair<size_t, double> oldRun;
+        {
+            LRUcache oldCache(capacity);
+            NullBuffer nullBuffer;
+            streambuf* console = cout.rdbuf(&nullBuffer);
+            oldRun = runRequests(requests, oldHits, [&](int key) {
+                if (oldCache.GET(key) != -1) return true;
+                oldCache.SET(key, key);
+                return false;
+                });
+            cout.rdbuf(console);
+        }
+        pair<size_t, double> newRun;
+        {
+            LRUCache<int, int> newCache(capacity);
+            newRun = runRequests(requests, newHits, [&](int key) {
+                int value;
+                if (newCache.get(key, value)) return true;
+                newCache.put(key, key);
+                return false;
+                });
+        }
+        size_t fixedHits = 0;
+        pair<size_t, double> fixedRun;
+        {
+            FixedLRUCache<int, int> fixedCache(capacity);
+            fixedRun = runRequests(requests, fixedHits, [&](int key) {
+                int value;
+                if (fixedCache.get(key, value)) return true;
+                fixedCache.put(key, key);
+                return false;
+                });
+        }
+        if (fixedHits != newHits) throw runtime_error("FixedLRUCache and LRUCache disagree on hits");
+
+        cout << setw(12) << capacity << setw(13) << requests.size()
+            << setw(13) << oldRun.first / oldRun.second / 1e6 << setw(12) << newRun.first / newRun.second / 1e6
+            << setw(15) << fixedRun.first / fixedRun.second / 1e6
+            << setw(10) << 100.0 * newHits / newRun.first << "%"
+            << setw(10) << 100.0 * oldRun.first / requests.size() << "%\n";
+    }
+}
+
+// Память и число выделений до создания кэша
+struct MemoryMark {
+    size_t rss;
+    size_t allocations;
+
+    MemoryMark() {
+        releaseFreeMemory();
+        rss = residentBytes();
+        allocations = allocationCount.load(memory_order_relaxed);
+    }
+};
+
+// Строка замера памяти: байт на элемент после создания и заполнения (по приросту RSS),
+// выделений на вставку, выделений на запрос и скорость в установившемся режиме.
+// fill(key) вставляет ключ, request(key) - GET, при промахе SET
+template <typename Fill, typename Request>
+void memoryBenchRow(const string& name, const MemoryMark& before, int capacity, const vector<int>& requests, Fill fill, Request request) {
+    for (int i = 0; i < capacity; i++) fill(i);
+    double fillAllocations = (double)(allocationCount.load(memory_order_relaxed) - before.allocations) / capacity;
+    size_t rssAfter = residentBytes();
+
+    if (before.rss != 0) cout << setw(12) << ((double)rssAfter - (double)before.rss) / capacity; //RSS мог и уменьшиться
+    else cout << setw(12) << "-";
+    cout << setw(12) << fillAllocations;
+    size_t allocationsBefore = allocationCount.load(memory_order_relaxed);
+    size_t hits = 0;
+    auto start = chrono::steady_clock::now();
+    for (int key : requests) hits += request(key);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << setw(12) << (double)(allocationCount.load(memory_order_relaxed) - allocationsBefore) / requests.size()
+        << setw(12) << requests.size() / seconds / 1e6 << "  " << name << "\n";
+}
+
+// Память и выделения: структуры LRUcache (unordered_map<int, DNode*> и DList, заполняются
+// напрямую - сам LRUcache печатал бы весь список на каждой вставке), LRUCache и FixedLRUCache
+void benchmarkMemory(int capacity) {
+    mt19937 generator(20240601);
+    uniform_int_distribution<int> keyDistribution(0, 2 * capacity - 1);
+    vector<int> requests(std::max(capacity, 1000000));
+    for (int& key : requests) key = keyDistribution(generator);
+
+    cout << "Ёмкость " << capacity << "; запросы после заполнения: GET, при промахе SET\n";
+    cout << " байт/элем. выдел./вст. выдел./зап.  млн зап./с  структура\n";
+    cout << fixed << setprecision(2);
+    {
+        MemoryMark before;
+        unordered_map<int, DNode*> cache;
+        DList order;
+        memoryBenchRow("unordered_map + DList (как в LRUcache)", before, capacity, requests,
+            [&](int key) { cache[key] = order.push_front(key, key); },
+            [&](int key) { //то же, что LRUcache::GET и SET без печати
+                auto found = cache.find(key);
+                if (found != cache.end()) {
+                    order.move_to_front(found->second);
+                    return true;
+                }
+                DNode* lastNode = order.remove_tail();
+                cache.erase(lastNode->key);
+                delete lastNode;
+                cache[key] = order.push_front(key, key);
+                return false;
+            });
+    }
+    {
+        MemoryMark before;
+        LRUCache<int, int> cache(capacity);
+        memoryBenchRow("LRUCache", before, capacity, requests,
+            [&](int key) { cache.put(key, key); },
+            [&](int key) {
+                int value;
+                if (cache.get(key, value)) return true;
+                cache.put(key, key);
+                return false;
+            });
+    }
+    {
+        MemoryMark before;
+        FixedLRUCache<int, int> cache(capacity);
+        memoryBenchRow("FixedLRUCache", before, capacity, requests,
+            [&](int key) { cache.put(key, key); },
+            [&](int key) {
+                int value;
+                if (cache.get(key, value)) return true;
+                cache.put(key, key);
+                return false;
+            });
+    }
+}
+
+// Каждый поток выполняет свою последовательность запросов "GET, при промахе SET".
+// Возвращает миллионы запросов в секунду на все потоки и долю попаданий
+template <typename Lookup>
+pair<double, double> threadedRequests(const vector<vector<int>>& requests, Lookup lookup) {
+    int threads = (int)requests.size();
+    atomic<int> ready(0);
+    atomic<bool> go(false);
+    atomic<size_t> hits(0);
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            size_t local = 0;
+            ready.fetch_add(1);
+            while (!go.load()) this_thread::yield();
+            for (int key : requests[t]) local += lookup(key);
+            hits.fetch_add(local);
+            });
+    }
+    while (ready.load() < threads) this_thread::yield();
+    auto start = chrono::steady_clock::now();
+    go.store(true);
+    for (auto& worker : workers) worker.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    size_t total = requests.size() * requests[0].size();
+    return make_pair(total / seconds / 1e6, 100.0 * hits.load() / total);
+}
+
+// Кэш из нескольких потоков: LRUCache под общим mutex против ShardedLRUCache с немедленным
+// и с отложенным продвижением. Ключи - ранги Ципфа (theta 0.99) из 10 * capacity
+void benchmarkThreads(int maxThreads, int capacity) {
+    const int REQUESTS_PER_THREAD = 1000000;
+    const int SHARDS = 64;
+    const size_t shards = ShardedLRUCache<int, int>(capacity, SHARDS).shardCount(); //при малой ёмкости сегментов меньше
+    ZipfGenerator zipf(10 * capacity);
+    cout << "Ёмкость " << capacity << ", ключи по Ципфу из " << 10 * capacity << ", по " << REQUESTS_PER_THREAD
+        << " запросов на поток; млн запросов в секунду (попадания, %)\n";
+    cout << "     потоки      общий mutex      " << shards << " сегм., сразу      " << shards << " сегм., отложенно\n";
+    cout << fixed << setprecision(2);
+    for (int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+        vector<vector<int>> requests(threads, vector<int>(REQUESTS_PER_THREAD));
+        for (int t = 0; t < threads; t++) {
+            mt19937 gen(20240601 + t);
+            for (int& key : requests[t]) key = zipf.next(gen);
+        }
+
+        pair<double, double> locked, sharded, deferred;
+        {
+            LRUCache<int, int> cache(capacity);
+            mutex cacheLock;
+            locked = threadedRequests(requests, [&](int key) {
+                lock_guard<mutex> guard(cacheLock);
+                int value;
+                if (cache.get(key, value)) return true;
+                cache.put(key, key);
+                return false;
+                });
+        }
+        {
+            ShardedLRUCache<int, int> cache(capacity, SHARDS, false);
+            sharded = threadedRequests(requests, [&](int key) {
+                int value;
+                if (cache.get(key, value)) return true;
+                cache.put(key, key);
+                return false;
+                });
+        }
+        {
+            ShardedLRUCache<int, int> cache(capacity, SHARDS, true);
+            deferred = threadedRequests(requests, [&](int key) {
+                int value;
+                if (cache.get(key, value)) return true;
+                cache.put(key, key);
+                return false;
+                });
+        }
+        cout << setw(11) << threads;
+        for (const pair<double, double>& result : { locked, sharded, deferred }) {
+            cout << setw(9) << result.first << " (" << setw(5) << result.second << ")";
+        }
+        cout << "\n";
+        if (threads == maxThreads) break;
+    }
+}
+
+// Обращение из трассы. Чтение при промахе заполняет кэш (как GET с загрузкой из источника),
+// запись - SET: вставляет или обновляет ключ
+struct TraceEntry {
+    int key;
+    bool write;
+};
+
+// Двоичная трасса: заголовок, затем на каждое обращение varint (по 7 бит, младшие вперёд) от
+// (zigzag(key - предыдущий key) << 1) | write. Соседние обращения часто близки по ключу,
+// поэтому обычно выходит 1-3 байта вместо десятка в тексте
+const char TRACE_MAGIC[8] = { 'L', 'R', '2', 'N', '7', 'T', 'R', 'C' };
+const uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t count; //обращений в трассе
+};
+
+string readWholeFile(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) throw runtime_error("Cannot open trace " + path);
+    string content;
+    in.seekg(0, ios::end);
+    content.resize((size_t)in.tellg());
+    in.seekg(0);
+    in.read(&content[0], content.size());
+    if (!in) throw runtime_error("Cannot read trace " + path);
+    return content;
+}
+
+vector<TraceEntry> parseBinaryTrace(const string& content, const string& path) {
+    TraceHeader header;
+    if (content.size() < sizeof(header)) throw runtime_error("Trace " + path + " is truncated");
+    memcpy(&header, content.data(), sizeof(header));
+    if (header.version != TRACE_VERSION) {
+        throw runtime_error("Trace " + path + " has version " + to_string(header.version) + ", expected " + to_string(TRACE_VERSION));
+    }
+    if (header.count > content.size()) throw runtime_error("Trace " + path + " is truncated or has a damaged header"); //на обращение нужен хотя бы байт
+    vector<TraceEntry> trace;
+    trace.reserve((size_t)header.count);
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(content.data());
+    size_t position = sizeof(header);
+    int64_t key = 0;
+    while (trace.size() < header.count) {
+        uint64_t code = 0;
+        for (int shift = 0; ; shift += 7) {
+            if (position == content.size() || shift > 63) throw runtime_error("Trace " + path + " is truncated or damaged");
+            unsigned char byte = data[position++];
+            code |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) break;
+        }
+        uint64_t zigzag = code >> 1;
+        key += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+        if (key < INT32_MIN || key > INT32_MAX) throw runtime_error("Trace " + path + " is damaged: key out of range");
+        trace.push_back(TraceEntry{ (int)key, (code & 1) != 0 });
+    }
+    if (position != content.size()) throw runtime_error("Trace " + path + " has extra bytes after " + to_string(header.count) + " entries");
+    return trace;
+}
+
+// Текстовая трасса: числа через пробелы или переводы строк - чтения; "GET x" - чтение,
+// "SET x y" - запись (значение не сохраняется)
+vector<TraceEntry> parseTextTrace(const string& content, const string& path) {
+    vector<TraceEntry> trace;
+    const char* cursor = content.c_str();
+    const char* end = cursor + content.size();
+    auto skipSpaces = [&] { while (cursor < end && isspace((unsigned char)*cursor)) cursor++; };
+    auto readNumber = [&](const char* after) {
+        skipSpaces();
+        char* numberEnd;
+        errno = 0;
+        long value = strtol(cursor, &numberEnd, 10);
+        if (numberEnd == cursor || (numberEnd < end && !isspace((unsigned char)*numberEnd)) || errno != 0
+            || value < INT_MIN || value > INT_MAX) {
+            string token(cursor, std::min<size_t>(end - cursor, 20));
+            throw runtime_error("Trace " + path + ": bad number" + after + " near \"" + token.substr(0, token.find('\n')) + "\"");
+        }
+        cursor = numberEnd;
+        return (int)value;
+    };
+    while (true) {
+        skipSpaces();
+        if (cursor == end) break;
+        if (end - cursor >= 3 && (memcmp(cursor, "GET", 3) == 0 || memcmp(cursor, "SET", 3) == 0)) {
+            bool write = *cursor == 'S';
+            cursor += 3;
+            int key = readNumber(write ? " after SET" : " after GET");
+            if (write) readNumber(" (value) after SET");
+            trace.push_back(TraceEntry{ key, write });
+        }
+        else {
+            trace.push_back(TraceEntry{ readNumber(""), false });
+        }
+    }
+    return trace;
+}
+
+// Трасса из файла; формат определяется по сигнатуре в начале
+vector<TraceEntry> readTrace(const string& path) {
+    string content = readWholeFile(path);
+    if (content.size() >= sizeof(TRACE_MAGIC) && memcmp(content.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0) {
+        return parseBinaryTrace(content, path);
+    }
+    return parseTextTrace(content, path);
+}
+
+void writeBinaryTrace(const vector<TraceEntry>& trace, const string& path) {
+    TraceHeader header;
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.reserved = 0;
+    header.count = trace.size();
+    string content(reinterpret_cast<const char*>(&header), sizeof(header));
+    int64_t previous = 0;
+    for (const TraceEntry& entry : trace) {
+        int64_t delta = entry.key - previous;
+        previous = entry.key;
+        uint64_t code = (((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63)) << 1 | (entry.write ? 1 : 0);
+        while (code >= 0x80) {
+            content.push_back((char)((code & 0x7f) | 0x80));
+            code >>= 7;
+        }
+        content.push_back((char)code);
+    }
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write(content.data(), content.size());
+    out.close();
+    if (!out) throw runtime_error("Cannot write trace " + path);
+}
+
+void writeTextTrace(const vector<TraceEntry>& trace, const string& path) {
+    ofstream out(path, ios::trunc);
+    for (const TraceEntry& entry : trace) {
+        if (entry.write) out << "SET " << entry.key << " " << entry.key << "\n";
+        else out << entry.key << "\n";
+    }
+    out.close();
+    if (!out) throw runtime_error("Cannot write trace " + path);
+}
+
+// Синтетическая трасса: 10^6 чтений по Ципфу из 10 * capacity ключей; если scans, то каждые
+// 10^5 обращений вставляется проход по 2 * capacity новым ключам (как пакетная задача)
+vector<TraceEntry> makeSyntheticTrace(int capacity, bool scans) {
+    const int ACCESSES = 1000000;
+    const int SCAN_PERIOD = 100000;
+    ZipfGenerator zipf(10 * capacity);
+    mt19937 gen(20240601);
+    vector<TraceEntry> trace;
+    int nextScanKey = 10 * capacity;
+    for (int i = 0; i < ACCESSES; i++) {
+        if (scans && i % SCAN_PERIOD == SCAN_PERIOD / 2) {
+            for (int j = 0; j < 2 * capacity; j++) trace.push_back(TraceEntry{ nextScanKey++, false });
+        }
+        trace.push_back(TraceEntry{ zipf.next(gen), false });
+    }
+    return trace;
+}
+
+// Прогон трассы через кэш без печати по ходу. Возвращает число попаданий среди чтений
+template <typename Cache>
+size_t simulatePolicy(const string& name, const vector<TraceEntry>& trace, size_t reads, int capacity) {
+    Cache cache(capacity);
+    size_t hits = 0;
+    auto start = chrono::steady_clock::now();
+    for (const TraceEntry& entry : trace) {
+        int value;
+        if (entry.write) cache.put(entry.key, entry.key);
+        else if (cache.get(entry.key, value)) hits++;
+        else cache.put(entry.key, entry.key);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << setw(12) << 100.0 * hits / std::max<size_t>(reads, 1) << "%" << setw(12) << trace.size() / seconds / 1e6
+        << "  " << name << "\n";
+    return hits;
+}
+
+// Дерево Фенвика: сумма отметок на префиксе позиций за O(log n)
+class FenwickTree {
+private:
+    vector<int> tree;
+
+public:
+    explicit FenwickTree(size_t n) : tree(n + 1, 0) {}
+
+    void add(size_t position, int delta) { //позиции с 1
+        for (; position < tree.size(); position += position & (0 - position)) tree[position] += delta;
+    }
+
+    int prefix(size_t position) const {
+        int sum = 0;
+        for (; position > 0; position -= position & (0 - position)) sum += tree[position];
+        return sum;
+    }
+};
+
+// Расстояния по стеку LRU (Mattson и др.) за один проход: для каждого чтения - сколько разных
+// ключей было с прошлого обращения к нему, считая его самого. LRU ёмкостью C попадает ровно
+// тогда, когда расстояние не больше C, поэтому одна гистограмма даёт кривую промахов сразу для
+// всех ёмкостей. Последнее обращение каждого ключа отмечено в дереве Фенвика по позиции в трассе.
+// histogram[d] - число чтений с расстоянием d; первые обращения к ключу в неё не попадают
+vector<size_t> stackDistances(const vector<TraceEntry>& trace) {
+    FenwickTree marks(trace.size());
+    unordered_map<int, size_t> lastAccess;
+    lastAccess.reserve(trace.size() / 4);
+    vector<size_t> histogram(1, 0);
+    for (size_t t = 1; t <= trace.size(); t++) {
+        const TraceEntry& entry = trace[t - 1];
+        auto inserted = lastAccess.emplace(entry.key, t);
+        if (!inserted.second) {
+            size_t previous = inserted.first->second;
+            size_t distance = marks.prefix(t - 1) - marks.prefix(previous - 1);
+            if (!entry.write) {
+                if (distance >= histogram.size()) histogram.resize(distance + 1, 0);
+                histogram[distance]++;
+            }
+            marks.add(previous, -1);
+            inserted.first->second = t;
+        }
+        marks.add(t, 1);
+    }
+    histogram.resize(std::max(histogram.size(), lastAccess.size() + 1), 0); //до числа разных ключей
+    return histogram;
+}
+
+void simulateTrace(const string& title, const vector<TraceEntry>& trace, int capacity) {
+    size_t reads = 0;
+    for (const TraceEntry& entry : trace) reads += !entry.write;
+    cout << title << ": " << trace.size() << " обращений (чтений " << reads << "), ёмкость " << capacity << "\n";
+    cout << "   попадания  млн обр./с  политика\n";
+    cout << fixed << setprecision(2);
+    size_t lruHits = simulatePolicy<LRUCache<int, int>>("LRU", trace, reads, capacity);
+    simulatePolicy<ClockCache<int, int>>("CLOCK", trace, reads, capacity);
+    simulatePolicy<SLRUCache<int, int>>("SLRU", trace, reads, capacity);
+    simulatePolicy<TwoQueueCache<int, int>>("2Q", trace, reads, capacity);
+    simulatePolicy<ARCCache<int, int>>("ARC", trace, reads, capacity);
+    simulatePolicy<WTinyLFUCache<int, int>>("W-TinyLFU", trace, reads, capacity);
+
+    auto start = chrono::steady_clock::now();
+    vector<size_t> histogram = stackDistances(trace);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    vector<size_t> hitsUpTo(histogram.size(), 0); //попадания LRU ёмкостью c
+    for (size_t c = 1; c < histogram.size(); c++) hitsUpTo[c] = hitsUpTo[c - 1] + histogram[c];
+    size_t distinct = histogram.size() - 1;
+    size_t atCapacity = hitsUpTo[std::min<size_t>(capacity, distinct)];
+    if (atCapacity != lruHits) throw runtime_error("Stack distances disagree with the LRU replay");
+
+    cout << "Кривая промахов LRU по расстояниям в стеке (один проход, " << seconds * 1000 << " мс; "
+        << distinct << " разных ключей)\n";
+    cout << "     ёмкость   попадания     промахи\n";
+    for (size_t c = 1; ; c *= 2) {
+        size_t hits = hitsUpTo[std::min(c, distinct)];
+        cout << setw(12) << c << setw(11) << 100.0 * hits / std::max<size_t>(reads, 1) << "%"
+            << setw(11) << 100.0 * (reads - hits) / std::max<size_t>(reads, 1) << "%\n";
+        if (c >= distinct) break;
+    }
+    cout << "\n";
+}
+
+// Диалоговый режим: команды SET x y и GET x с печатью порядка после каждой
+void interactive() {
     cout << "Введите ёмкость кэша: ";
     int cap;
     cin >> cap;
@@ -157,7 +740,9 @@ int main() {
     int q;
     cin >> q;
 
-    LRUcache cache(cap);
+    // Как в LRUcache: при ёмкости 0 и меньше новый ключ всё равно сохраняется,
+    // вытесняя предыдущий, то есть кэш ведёт себя как кэш на один элемент
+    ConsoleLRUCache cache(cap < 1 ? 1 : cap);
 
     cout << "\nВведите запросы (SET x y или GET x):" << endl;
     for (int i = 0; i < q; i++) {
@@ -167,12 +752,21 @@ int main() {
         if (command == "SET") {
             int x, y;
             cin >> x >> y;
-            cache.SET(x, y);
+            cache.put(x, y);
+            cout << "SET " << x << " " << y << " : ";
+            printOrder(cache);
         }
         else if (command == "GET") {
             int x;
             cin >> x;
-            cache.GET(x);
+            int value;
+            if (cache.get(x, value)) {
+                cout << "GET " << x << " : " << value << " ";
+                printOrder(cache);
+            }
+            else {
+                cout << "GET " << x << " : -1" << endl;
+            }
         }
         else {
             cout << "Неизвестная команда: " << command << endl;
@@ -180,6 +774,95 @@ int main() {
             i--;
         }
     }
+}
+
+int main(int argc, char* argv[]) {
+    setlocale(LC_ALL, "RU");
+
+    // Без аргументов - диалоговый режим. Замеры:
+    //   lr2n7 bench [наибольшая ёмкость] - скорость реализаций кэша
+    //   lr2n7 membench [ёмкость] - память на элемент и выделения памяти на запрос
+    //   lr2n7 mtbench [потоки] [ёмкость] - кэш из нескольких потоков, ключи по Ципфу
+    //   lr2n7 sim [ёмкость] [файл трассы] - прогон трассы через политики вытеснения и кривая
+    //     промахов LRU (без файла - синтетические трассы по Ципфу без проходов и с проходами)
+    //   lr2n7 convert <трасса> <выход> - перевести трассу в двоичный формат (или в текст, если выход .txt)
+    //   lr2n7 gentrace <выход> [ёмкость] - записать синтетическую трассу с проходами
+    if (argc > 1) {
+        string command = argv[1];
+        bool known = (command == "bench" && argc <= 3)
+            || (command == "membench" && argc <= 3)
+            || (command == "mtbench" && argc <= 4)
+            || (command == "sim" && argc <= 4)
+            || (command == "convert" && argc == 4)
+            || (command == "gentrace" && (argc == 3 || argc == 4));
+        if (!known) {
+            cerr << "Использование:\n"
+                << "  " << argv[0] << "\n"
+                << "  " << argv[0] << " bench [наибольшая ёмкость]\n"
+                << "  " << argv[0] << " membench [ёмкость]\n"
+                << "  " << argv[0] << " mtbench [потоки] [ёмкость]\n"
+                << "  " << argv[0] << " sim [ёмкость] [файл трассы]\n"
+                << "  " << argv[0] << " convert <трасса> <выход>\n"
+                << "  " << argv[0] << " gentrace <выход> [ёмкость]" << endl;
+            return 1;
+        }
+        try {
+            if (command == "bench") {
+                int maxCapacity = argc == 3 ? stoi(argv[2]) : 10000000;
+                if (maxCapacity < 1000 || maxCapacity > 100000000) throw runtime_error("capacity must be 1000..10^8");
+                benchmarkCaches(maxCapacity);
+            }
+            else if (command == "sim") {
+                int capacity = argc >= 3 ? stoi(argv[2]) : 10000;
+                if (capacity < 1 || capacity > 10000000) throw runtime_error("capacity must be 1..10^7");
+                if (argc == 4) {
+                    auto start = chrono::steady_clock::now();
+                    vector<TraceEntry> trace = readTrace(argv[3]);
+                    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                    cout << "Чтение трассы: " << fixed << setprecision(2) << seconds * 1000 << " мс, "
+                        << trace.size() / std::max(seconds, 1e-9) / 1e6 << " млн обращений в секунду\n";
+                    simulateTrace(argv[3], trace, capacity);
+                }
+                else {
+                    simulateTrace("Ципф", makeSyntheticTrace(capacity, false), capacity);
+                    simulateTrace("Ципф с проходами", makeSyntheticTrace(capacity, true), capacity);
+                }
+            }
+            else if (command == "convert" || command == "gentrace") {
+                string output = argv[command == "convert" ? 3 : 2];
+                vector<TraceEntry> trace;
+                if (command == "convert") trace = readTrace(argv[2]);
+                else {
+                    int capacity = argc == 4 ? stoi(argv[3]) : 10000;
+                    if (capacity < 1 || capacity > 10000000) throw runtime_error("capacity must be 1..10^7");
+                    trace = makeSyntheticTrace(capacity, true);
+                }
+                bool text = output.size() >= 4 && output.compare(output.size() - 4, 4, ".txt") == 0;
+                if (text) writeTextTrace(trace, output);
+                else writeBinaryTrace(trace, output);
+                cout << trace.size() << " обращений записано в " << output << (text ? " (текст)" : " (двоичный формат)") << endl;
+            }
+            else if (command == "mtbench") {
+                int threads = argc >= 3 ? stoi(argv[2]) : (int)std::max(thread::hardware_concurrency(), 1u);
+                int capacity = argc == 4 ? stoi(argv[3]) : 100000;
+                if (threads < 1 || threads > 256 || capacity < 1 || capacity > 10000000) {
+                    throw runtime_error("threads must be 1..256 and capacity 1..10^7");
+                }
+                benchmarkThreads(threads, capacity);
+            }
+            else {
+                int capacity = argc == 3 ? stoi(argv[2]) : 1000000;
+                if (capacity < 1 || capacity > 100000000) throw runtime_error("capacity must be 1..10^8");
+                benchmarkMemory(capacity);
+            }
+        }
+        catch (const std::exception& e) {
+            cerr << "Ошибка: " << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
 
+    interactive();
     return 0;
 }
\ No newline at end of file
@@ -8,17 +8,22 @@
 #include <algorithm>
 #include <queue>
 #include <functional>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <sstream>
+#include "CompressionBench.h"
 
 using namespace std;
 
 struct HuffmanNode {
     wchar_t symbol;
-    int frequency;
+    uint64_t frequency;
     HuffmanNode* left;
     HuffmanNode* right;
 
-    HuffmanNode(wchar_t s, int freq) : symbol(s), frequency(freq), left(nullptr), right(nullptr) {}
-    HuffmanNode(int freq, HuffmanNode* l, HuffmanNode* r) : symbol(L'\0'), frequency(freq), left(l), right(r) {}
+    HuffmanNode(wchar_t s, uint64_t freq) : symbol(s), frequency(freq), left(nullptr), right(nullptr) {}
+    HuffmanNode(uint64_t freq, HuffmanNode* l, HuffmanNode* r) : symbol(L'\0'), frequency(freq), left(l), right(r) {}
 };
 
 struct QNode {
@@ -26,12 +31,12 @@ struct QNode {
     QNode* next;
 };
 
-struct PriorityQueue { //моя собственная, работает не как все очереди
+struct ListQueue { //моя собственная, работает не как все очереди
     QNode* front;
     QNode* rear;
     size_t sz;
 
-    PriorityQueue() : front(nullptr), rear(nullptr), sz(0) {}
+    ListQueue() : front(nullptr), rear(nullptr), sz(0) {}
 };
 
 // Функция для подсчета частот символов
@@ -44,7 +49,7 @@ map<wchar_t, int> howOften(const wstring& input) {
 }
 
 // Добавление в конец
-void QPUSH(PriorityQueue& queue, HuffmanNode* value) {
+void LQPUSH(ListQueue& queue, HuffmanNode* value) {
     QNode* newNode = new QNode{ value, nullptr };
 
     if (queue.rear == nullptr) {
@@ -59,7 +64,7 @@ void QPUSH(PriorityQueue& queue, HuffmanNode* value) {
 }
 
 // Удаление из начала 
-void QPOP(PriorityQueue& queue) { // передача по ссылке
+void LQPOP(ListQueue& queue) { // передача по ссылке
     if (queue.front == nullptr) {
         throw runtime_error("Ошибка: очередь пуста!");
     }
@@ -76,7 +81,7 @@ void QPOP(PriorityQueue& queue) { // передача по ссылке
 }
 
 // Получение минимального элемента (из начала)
-HuffmanNode* QFRONT(const PriorityQueue& queue) {
+HuffmanNode* LQFRONT(const ListQueue& queue) {
     if (queue.front == nullptr) {
         throw runtime_error("Ошибка: очередь пуста!");
     }
@@ -84,7 +89,7 @@ HuffmanNode* QFRONT(const PriorityQueue& queue) {
 }
 
 // Вывод очереди для моего просмотра
-void QPRINT(const PriorityQueue& queue) {
+void LQPRINT(const ListQueue& queue) {
     if (queue.front == nullptr) {
         cout << "Очередь пуста!" << endl;
         return;
@@ -106,7 +111,7 @@ void QPRINT(const PriorityQueue& queue) {
 }
 
  //Сортировка очереди по возрастанию частот(min в начале)
-void sortQueue(PriorityQueue& queue) {
+void sortListQueue(ListQueue& queue) {
     if (queue.sz <= 1) return;
 
     // Собираем все узлы в вектор
@@ -124,50 +129,179 @@ void sortQueue(PriorityQueue& queue) {
 
     // Очищаем очередь
     while (queue.front != nullptr) {
-        QPOP(queue);
+        LQPOP(queue);
     }
 
     // Заполняем отсортированными элементами
     for (HuffmanNode* node : nodes) {
-        QPUSH(queue, node);
+        LQPUSH(queue, node);
     }
 }
 
 // Создание отсортированной очереди
-PriorityQueue createList(const map<wchar_t, int>& frequency) {
-    PriorityQueue freeNodes;
+ListQueue createListQueue(const map<wchar_t, int>& frequency) {
+    ListQueue freeNodes;
 
     for (const auto& elem : frequency) {
         HuffmanNode* newNode = new HuffmanNode(elem.first, elem.second);
-        QPUSH(freeNodes, newNode);
+        LQPUSH(freeNodes, newNode);
     }
 
     // Сортируем по возрастанию (min в начале)
-    sortQueue(freeNodes);
+    sortListQueue(freeNodes);
     return freeNodes;
 }
 
 // Построение дерева Хаффмана (исправлено)
-HuffmanNode* buildHuffmanTree(PriorityQueue& freeNodes) { // передача по ссылке
+// Старый вариант: очередь пересортировывается после каждого слияния, O(n² log n).
+// Оставлен для сравнения в treebench
+HuffmanNode* buildHuffmanTreeSorted(ListQueue& freeNodes) { // передача по ссылке
     //int step = 1;
     //cout << "\n=== ПОСТРОЕНИЕ ДЕРЕВА ===" << endl;
-    //QPRINT(freeNodes);
+    //LQPRINT(freeNodes);
 
     while (freeNodes.sz > 1) {
        // cout << "\n=== ШАГ " << step << " ===" << endl;
+        HuffmanNode* left = LQFRONT(freeNodes);
+        LQPOP(freeNodes);
+        HuffmanNode* right = LQFRONT(freeNodes);
+        LQPOP(freeNodes);
+        //wcout << L"Объединяем: '" << left->symbol << L"' и '" << right->symbol << L"'" << endl;
+        uint64_t parentFreq = left->frequency + right->frequency;
+        HuffmanNode* parent = new HuffmanNode(parentFreq, left, right);
+        LQPUSH(freeNodes, parent);
+        sortListQueue(freeNodes);
+
+        //cout << "После шага " << step << ":" << endl;
+        //LQPRINT(freeNodes);
+        //step++;
+    }
+
+    return LQFRONT(freeNodes);
+}
+
+// Очередь с приоритетом на d-арной куче (минимальная частота в корне).
+// При равных частотах раньше выходит узел, добавленный раньше, поэтому
+// дерево всегда строится одинаково.
+const size_t HEAP_ARITY = 4;
+
+struct HeapEntry {
+    HuffmanNode* data;
+    uint64_t order; // номер добавления - для детерминированного выбора при равных частотах
+};
+
+struct PriorityQueue {
+    vector<HeapEntry> heap;
+    uint64_t pushed;
+    size_t sz;
+
+    PriorityQueue() : pushed(0), sz(0) {}
+};
+
+// Сравнение элементов кучи: true, если a должен выйти раньше b
+bool heapLess(const HeapEntry& a, const HeapEntry& b) {
+    if (a.data->frequency != b.data->frequency) {
+        return a.data->frequency < b.data->frequency;
+    }
+    return a.order < b.order;
+}
+
+// Добавление с просеиванием вверх
+void QPUSH(PriorityQueue& queue, HuffmanNode* value) {
+    HeapEntry entry{ value, queue.pushed++ };
+    size_t i = queue.heap.size();
+    queue.heap.push_back(entry);
+    while (i > 0) {
+        size_t parent = (i - 1) / HEAP_ARITY;
+        if (!heapLess(entry, queue.heap[parent])) break;
+        queue.heap[i] = queue.heap[parent];
+        i = parent;
+    }
+    queue.heap[i] = entry;
+    queue.sz++;
+}
+
+// Удаление минимального элемента с просеиванием вниз
+void QPOP(PriorityQueue& queue) { // передача по ссылке
+    if (queue.heap.empty()) {
+        throw runtime_error("Ошибка: очередь пуста!");
+    }
+
+    HeapEntry last = queue.heap.back();
+    queue.heap.pop_back();
+    queue.sz--;
+    size_t n = queue.heap.size();
+    if (n == 0) return;
+
+    size_t i = 0;
+    while (true) {
+        size_t first = i * HEAP_ARITY + 1;
+        if (first >= n) break;
+        size_t best = first;
+        size_t stop = min(first + HEAP_ARITY, n);
+        for (size_t c = first + 1; c < stop; c++) {
+            if (heapLess(queue.heap[c], queue.heap[best])) best = c;
+        }
+        if (!heapLess(queue.heap[best], last)) break;
+        queue.heap[i] = queue.heap[best];
+        i = best;
+    }
+    queue.heap[i] = last;
+}
+
+// Получение минимального элемента (корень кучи)
+HuffmanNode* QFRONT(const PriorityQueue& queue) {
+    if (queue.heap.empty()) {
+        throw runtime_error("Ошибка: очередь пуста!");
+    }
+    return queue.heap[0].data;
+}
+
+// Вывод очереди для моего просмотра (по возрастанию, на копии кучи)
+void QPRINT(const PriorityQueue& queue) {
+    if (queue.heap.empty()) {
+        cout << "Очередь пуста!" << endl;
+        return;
+    }
+
+    cout << "Очередь [" << queue.sz << "] (min->max): ";
+    PriorityQueue copy = queue;
+    while (copy.sz > 0) {
+        HuffmanNode* node = QFRONT(copy);
+        QPOP(copy);
+        wcout << L"'";
+        if (node->symbol == L' ') wcout << L"ПРОБЕЛ";
+        else if (node->symbol == L'\n') wcout << L"\\n";
+        else if (node->left != nullptr) wcout << L"ВНУТР";
+        else wcout << node->symbol;
+        wcout << L"'(" << node->frequency << L")";
+        if (copy.sz > 0) cout << " -> ";
+    }
+    cout << " -> NULL" << endl;
+}
+
+// Создание очереди свободных узлов
+PriorityQueue createList(const map<wchar_t, int>& frequency) {
+    PriorityQueue freeNodes;
+    freeNodes.heap.reserve(frequency.size());
+
+    for (const auto& elem : frequency) {
+        HuffmanNode* newNode = new HuffmanNode(elem.first, elem.second);
+        QPUSH(freeNodes, newNode);
+    }
+    return freeNodes;
+}
+
+// Построение дерева Хаффмана: каждое слияние - два извлечения и одна вставка, O(n log n)
+HuffmanNode* buildHuffmanTree(PriorityQueue& freeNodes) { // передача по ссылке
+    while (freeNodes.sz > 1) {
         HuffmanNode* left = QFRONT(freeNodes);
         QPOP(freeNodes);
         HuffmanNode* right = QFRONT(freeNodes);
         QPOP(freeNodes);
-        //wcout << L"Объединяем: '" << left->symbol << L"' и '" << right->symbol << L"'" << endl;
-        int parentFreq = left->frequency + right->frequency;
+        uint64_t parentFreq = left->frequency + right->frequency;
         HuffmanNode* parent = new HuffmanNode(parentFreq, left, right);
         QPUSH(freeNodes, parent);
-        sortQueue(freeNodes);
-
-        //cout << "После шага " << step << ":" << endl;
-        //QPRINT(freeNodes);
-        //step++;
     }
 
     return QFRONT(freeNodes);
@@ -205,12 +339,13 @@ void printHuffmanTree(HuffmanNode * node, const string & prefix = "", bool isLef
     printHuffmanTree(node->right, prefix + (isLeft ? "|   " : "    "), false);
 }
 // Функция для генерации кодов Хаффмана
-void generateHuffmanCodes(HuffmanNode* root, const string& code = "", map<wchar_t, string>& codes = *new map<wchar_t, string>) {
+void generateHuffmanCodes(HuffmanNode* root, const string& code, map<wchar_t, string>& codes) {
     if (root == nullptr) return;
 
-    // Если это листовой узел
+    // Если это листовой узел. Лист в корне (строка из одного символа) получает код "0",
+    // как и в каноническом коде: код нулевой длины закодировать нельзя
     if (root->symbol != L'\0') {
-        codes[root->symbol] = code;
+        codes[root->symbol] = code.empty() ? "0" : code;
     }
 
     // Рекурсивно обходим левое и правое поддеревья
@@ -246,9 +381,1283 @@ void cleanupHuffmanTree(HuffmanNode* root) {
     delete root;
 }
 
-int main() {
+// ------------------- Дерево в плоском массиве -------------------
+
+// Узел дерева Хаффмана в плоском массиве: дети - индексы в том же массиве, у листьев -1
+struct FlatNode {
+    uint64_t frequency;
+    int left;
+    int right;
+    int symbol;
+    int depth;
+};
+
+// Функция для подсчета частот в массив счётчиков (размер - по наибольшему символу)
+vector<uint64_t> howOftenCounts(const wstring& input) {
+    size_t alphabetSize = 0;
+    for (wchar_t elem : input) {
+        alphabetSize = max(alphabetSize, (size_t)elem + 1);
+    }
+    vector<uint64_t> counts(alphabetSize, 0);
+    for (wchar_t elem : input) {
+        counts[(size_t)elem]++;
+    }
+    return counts;
+}
+
+// Разреженная гистограмма для широких символов. Символы до U+07FF (латиница,
+// кириллица, греческий...) считаются в плотном массиве, остальные - в хеш-таблице
+// с открытой адресацией, поэтому память зависит от числа разных символов,
+// а не от самого большого кода.
+struct WideHistogram {
+    static const uint32_t DENSE_SIZE = 0x800;
+    static const uint32_t EMPTY_KEY = 0xFFFFFFFF;
+
+    vector<uint64_t> dense;
+    vector<uint32_t> keys;   // ключи хеш-таблицы, EMPTY_KEY - свободная ячейка
+    vector<uint64_t> values; // счётчики для keys
+    size_t used;
+
+    WideHistogram() : dense(DENSE_SIZE, 0), keys(64, EMPTY_KEY), values(64, 0), used(0) {}
+
+    void add(uint32_t symbol, uint64_t n = 1) {
+        if (symbol < DENSE_SIZE) {
+            dense[symbol] += n;
+            return;
+        }
+        size_t mask = keys.size() - 1;
+        size_t i = (symbol * 0x9E3779B1u) & mask;
+        while (keys[i] != symbol && keys[i] != EMPTY_KEY) {
+            i = (i + 1) & mask;
+        }
+        if (keys[i] == EMPTY_KEY) {
+            if ((used + 1) * 2 > keys.size()) { // держим заполнение не больше половины
+                grow();
+                add(symbol, n);
+                return;
+            }
+            keys[i] = symbol;
+            used++;
+        }
+        values[i] += n;
+    }
+
+    void grow() {
+        vector<uint32_t> oldKeys(keys.size() * 2, EMPTY_KEY);
+        vector<uint64_t> oldValues(values.size() * 2, 0);
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        used = 0;
+        for (size_t i = 0; i < oldKeys.size(); i++) {
+            if (oldKeys[i] != EMPTY_KEY) add(oldKeys[i], oldValues[i]);
+        }
+    }
+
+    // Деление всех частот пополам (ненулевые остаются ненулевыми), возвращает новую сумму
+    uint64_t halve() {
+        uint64_t total = 0;
+        for (uint64_t& c : dense) {
+            c = (c + 1) / 2;
+            total += c;
+        }
+        for (uint64_t& c : values) {
+            c = (c + 1) / 2;
+            total += c;
+        }
+        return total;
+    }
+
+    // Все ненулевые счётчики в виде (символ, частота), по возрастанию символа
+    vector<pair<int, uint64_t>> items() const {
+        vector<pair<int, uint64_t>> result;
+        for (uint32_t s = 0; s < DENSE_SIZE; s++) {
+            if (dense[s] != 0) result.push_back(make_pair((int)s, dense[s]));
+        }
+        size_t denseCount = result.size();
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] != EMPTY_KEY) result.push_back(make_pair((int)keys[i], values[i]));
+        }
+        sort(result.begin() + denseCount, result.end());
+        return result;
+    }
+};
+
+// Функция для подсчета частот через разреженную гистограмму
+WideHistogram howOftenSparse(const wstring& input) {
+    WideHistogram histogram;
+    for (wchar_t elem : input) {
+        histogram.add((uint32_t)elem);
+    }
+    return histogram;
+}
+
+// Построение дерева Хаффмана в одном массиве методом двух очередей:
+// листья сортируются по частоте, а внутренние узлы появляются уже в порядке
+// неубывания частот, поэтому минимум всегда в начале одной из двух очередей.
+// Первые leafCount элементов - листья, корень - последний элемент.
+// symbols - пары (символ, частота) с ненулевыми частотами.
+vector<FlatNode> buildFlatHuffmanTree(const vector<pair<int, uint64_t>>& symbols) {
+    size_t leafCount = symbols.size();
+
+    vector<FlatNode> nodes;
+    if (leafCount == 0) return nodes;
+    nodes.reserve(2 * leafCount - 1); // единственное выделение памяти
+    for (const auto& elem : symbols) {
+        nodes.push_back({ elem.second, -1, -1, elem.first, 0 });
+    }
+    sort(nodes.begin(), nodes.end(), [](const FlatNode& a, const FlatNode& b) {
+        if (a.frequency == b.frequency) return a.symbol < b.symbol;
+        return a.frequency < b.frequency;
+        });
+
+    size_t nextLeaf = 0;
+    size_t nextInternal = leafCount;
+    auto takeMin = [&]() -> int {
+        // При равных частотах берём лист - так дерево получается ниже
+        if (nextLeaf < leafCount
+            && (nextInternal >= nodes.size() || nodes[nextLeaf].frequency <= nodes[nextInternal].frequency)) {
+            return (int)nextLeaf++;
+        }
+        return (int)nextInternal++;
+    };
+    while (nodes.size() < 2 * leafCount - 1) {
+        int left = takeMin();
+        int right = takeMin();
+        nodes.push_back({ nodes[left].frequency + nodes[right].frequency, left, right, -1, 0 });
+    }
+
+    // Родитель всегда правее детей, поэтому глубины считаются одним проходом от корня
+    for (size_t i = nodes.size(); i-- > leafCount;) {
+        nodes[nodes[i].left].depth = nodes[i].depth + 1;
+        nodes[nodes[i].right].depth = nodes[i].depth + 1;
+    }
+    return nodes;
+}
+
+// То же самое для плотного массива счётчиков
+vector<FlatNode> buildFlatHuffmanTree(const vector<uint64_t>& counts) {
+    vector<pair<int, uint64_t>> symbols;
+    for (size_t s = 0; s < counts.size(); s++) {
+        if (counts[s] != 0) symbols.push_back(make_pair((int)s, counts[s]));
+    }
+    return buildFlatHuffmanTree(symbols);
+}
+
+// Функция для генерации канонических кодов по глубинам листьев (без рекурсии)
+map<wchar_t, string> generateCanonicalCodes(const vector<FlatNode>& nodes) {
+    vector<pair<int, int>> leaves; // (длина, символ)
+    for (const FlatNode& node : nodes) {
+        if (node.symbol < 0) break; // листья закончились
+        leaves.push_back(make_pair(max(node.depth, 1), node.symbol));
+    }
+    sort(leaves.begin(), leaves.end());
+
+    map<wchar_t, string> codes;
+    uint64_t code = 0;
+    int prevLength = leaves.empty() ? 0 : leaves[0].first;
+    for (const auto& leaf : leaves) {
+        code <<= (leaf.first - prevLength);
+        prevLength = leaf.first;
+        string bits(leaf.first, '0');
+        for (int i = 0; i < leaf.first && i < 64; i++) {
+            if ((code >> i) & 1) bits[leaf.first - 1 - i] = '1';
+        }
+        codes[(wchar_t)leaf.second] = bits;
+        code++;
+    }
+    return codes;
+}
+
+// ------------------- Сжатие UTF-8 текста -------------------
+//
+// Текст читается потоком, UTF-8 раскладывается в кодовые точки. Модель Хаффмана
+// строится по MAX_MODEL_SYMBOLS самым частым кодовым точкам, остальные
+// кодируются символом ESCAPE и 21 битом самой кодовой точки. Байты, которые
+// не образуют корректный UTF-8, становятся символами RAW_BYTE_BASE + байт,
+// поэтому распакованный файл совпадает с исходным побайтно.
+//
+// Формат файла:
+//   "HUW8", версия (1 байт)
+//   исходный размер в байтах (8), число символов (8), CRC-32 исходных байтов (4)
+//   число символов модели K (4), затем K раз: кодовая точка (4) и длина кода (1)
+//   длина кода ESCAPE (1, 0 - редких символов нет)
+//   битовый поток до конца файла
+// Все числа - little-endian.
+
+const uint32_t RAW_BYTE_BASE = 0x110000;  // сразу за последней кодовой точкой Unicode
+const int ESCAPE_BITS = 21;               // хватает и для RAW_BYTE_BASE + 255
+const size_t MAX_MODEL_SYMBOLS = 4096;
+const int MAX_CODE_LENGTH = 32;
+const int DECODE_TABLE_BITS = 11;
+const size_t STREAM_CHUNK_SIZE = 1 << 20;
+const char UTF8_FILE_MAGIC[4] = { 'H', 'U', 'W', '8' };
+const uint8_t UTF8_FILE_VERSION = 1;
+
+// Функция для декодирования UTF-8 из куска данных. Возвращает, сколько байт
+// использовано: незаконченная последовательность в конце куска остаётся
+// на следующий раз, если это не последний кусок (final)
+size_t decodeUtf8(const uint8_t* data, size_t size, bool final, vector<uint32_t>& out) {
+    size_t pos = 0;
+    while (pos < size) {
+        uint8_t b = data[pos];
+        if (b < 0x80) {
+            out.push_back(b);
+            pos++;
+            continue;
+        }
+
+        int need;
+        uint32_t cp;
+        uint8_t low = 0x80, high = 0xBF; // допустимый диапазон второго байта
+        if (b >= 0xC2 && b <= 0xDF) { need = 1; cp = b & 0x1F; }
+        else if (b >= 0xE0 && b <= 0xEF) {
+            need = 2; cp = b & 0x0F;
+            if (b == 0xE0) low = 0xA0;       // слишком длинная запись
+            if (b == 0xED) high = 0x9F;      // суррогаты
+        }
+        else if (b >= 0xF0 && b <= 0xF4) {
+            need = 3; cp = b & 0x07;
+            if (b == 0xF0) low = 0x90;
+            if (b == 0xF4) high = 0x8F;      // больше U+10FFFF
+        }
+        else {
+            out.push_back(RAW_BYTE_BASE + b);
+            pos++;
+            continue;
+        }
+
+        bool valid = true;
+        int i = 1;
+        for (; i <= need && pos + i < size; i++) {
+            uint8_t c = data[pos + i];
+            if (c < (i == 1 ? low : 0x80) || c > (i == 1 ? high : 0xBF)) {
+                valid = false;
+                break;
+            }
+            cp = (cp << 6) | (c & 0x3F);
+        }
+        if (valid && i <= need) {
+            if (!final) break; // ждём продолжение в следующем куске
+            valid = false;
+        }
+        if (!valid) {
+            out.push_back(RAW_BYTE_BASE + b);
+            pos++;
+            continue;
+        }
+        out.push_back(cp);
+        pos += need + 1;
+    }
+    return pos;
+}
+
+// Функция для записи символа обратно в байты, возвращает их количество
+int encodeUtf8(uint32_t cp, uint8_t* out) {
+    if (cp >= RAW_BYTE_BASE) { out[0] = (uint8_t)(cp - RAW_BYTE_BASE); return 1; }
+    if (cp < 0x80) { out[0] = (uint8_t)cp; return 1; }
+    if (cp < 0x800) {
+        out[0] = (uint8_t)(0xC0 | (cp >> 6));
+        out[1] = (uint8_t)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (uint8_t)(0xE0 | (cp >> 12));
+        out[1] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (uint8_t)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (uint8_t)(0xF0 | (cp >> 18));
+    out[1] = (uint8_t)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (uint8_t)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Функция для потокового чтения: кусками по chunkSize байт отдаёт
+// кодовые точки и исходные байты (для CRC), память не зависит от размера файла.
+// Если задан firstChunkSize, куски начинаются с него и удваиваются до chunkSize
+void readCodePoints(istream& in, const function<void(const vector<uint32_t>&, const uint8_t*, size_t)>& onChunk,
+    size_t chunkSize = STREAM_CHUNK_SIZE, size_t firstChunkSize = 0) {
+    vector<uint8_t> buffer(chunkSize + 4);
+    vector<uint32_t> symbols;
+    symbols.reserve(chunkSize);
+    size_t carry = 0; // незаконченная последовательность с прошлого куска
+    size_t readSize = firstChunkSize != 0 ? firstChunkSize : chunkSize;
+    while (true) {
+        in.read((char*)buffer.data() + carry, readSize);
+        readSize = min(readSize * 2, chunkSize);
+        size_t got = (size_t)in.gcount();
+        size_t size = carry + got;
+        bool final = got == 0 || !in;
+        symbols.clear();
+        size_t used = decodeUtf8(buffer.data(), size, final, symbols);
+        onChunk(symbols, buffer.data(), used);
+        carry = size - used;
+        copy(buffer.begin() + used, buffer.begin() + size, buffer.begin());
+        if (final) break;
+    }
+}
+
+// Функция для подсчёта CRC-32 (полином 0xEDB88320), можно считать по частям
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t size) {
+    static const vector<uint32_t> table = [] {
+        vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void writeLE(ostream& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.put((char)(value >> (8 * i)));
+    }
+}
+
+uint64_t readLE(istream& in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        int byte = in.get();
+        if (byte == EOF) {
+            throw runtime_error("Ошибка: заголовок файла обрезан");
+        }
+        value |= (uint64_t)byte << (8 * i);
+    }
+    return value;
+}
+
+// Запись битового потока через 64-битный буфер (старшие биты кода идут первыми)
+struct BitWriter {
+    vector<uint8_t>& out;
+    uint64_t buffer;
+    int bitCount;
+
+    BitWriter(vector<uint8_t>& output) : out(output), buffer(0), bitCount(0) {}
+
+    void put(uint32_t code, int length) {
+        buffer = (buffer << length) | code;
+        bitCount += length;
+        if (bitCount >= 32) {
+            bitCount -= 32;
+            uint32_t word = (uint32_t)(buffer >> bitCount);
+            out.push_back((uint8_t)(word >> 24));
+            out.push_back((uint8_t)(word >> 16));
+            out.push_back((uint8_t)(word >> 8));
+            out.push_back((uint8_t)word);
+        }
+    }
+
+    void flush() {
+        while (bitCount >= 8) {
+            bitCount -= 8;
+            out.push_back((uint8_t)(buffer >> bitCount));
+        }
+        if (bitCount > 0) {
+            out.push_back((uint8_t)(buffer << (8 - bitCount)));
+            bitCount = 0;
+        }
+        buffer = 0;
+    }
+};
+
+// Чтение битового потока из массива или из istream кусками, за концом данных - нули
+struct BitReader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    uint64_t buffer;
+    int bitCount;
+    istream* source;
+    vector<uint8_t> chunk;
+
+    BitReader(const uint8_t* d, size_t sz)
+        : data(d), size(sz), pos(0), buffer(0), bitCount(0), source(nullptr) {}
+    BitReader(istream& in)
+        : data(nullptr), size(0), pos(0), buffer(0), bitCount(0), source(&in), chunk(STREAM_CHUNK_SIZE) {}
+
+    void refill() {
+        while (bitCount <= 56) {
+            if (pos >= size && source != nullptr && *source) {
+                source->read((char*)chunk.data(), chunk.size());
+                data = chunk.data();
+                size = (size_t)source->gcount();
+                pos = 0;
+            }
+            uint64_t byte = pos < size ? data[pos] : 0;
+            pos++;
+            buffer |= byte << (56 - bitCount);
+            bitCount += 8;
+        }
+    }
+
+    uint32_t peek(int n) const { return (uint32_t)(buffer >> (64 - n)); }
+
+    void skip(int n) {
+        buffer <<= n;
+        bitCount -= n;
+    }
+};
+
+// Модель: символы модели (по номеру), длины и канонические коды.
+// Номер symbols.size() - это ESCAPE
+struct UnicodeModel {
+    vector<uint32_t> symbols;
+    vector<uint8_t> lengths;
+    vector<uint32_t> codes;
+    vector<int> denseIndex;                    // номер символа модели для кодовых точек < DENSE_SIZE
+    map<uint32_t, int> sparseIndex;            // для остальных
+
+    int escape() const { return (int)symbols.size(); }
+
+    int indexOf(uint32_t cp) const {
+        if (cp < WideHistogram::DENSE_SIZE) return denseIndex[cp];
+        auto it = sparseIndex.find(cp);
+        return it == sparseIndex.end() ? -1 : it->second;
+    }
+};
+
+// Функция для проверки длин кодов, прочитанных из файла: каждая от 0 до MAX_CODE_LENGTH
+// и сумма 2^-длина не больше 1 (неравенство Крафта). Иначе коды не префиксные
+// и таблица декодирования выходит за свои границы
+bool validCodeLengths(const vector<uint8_t>& lengths) {
+    uint64_t kraft = 0; // сумма в единицах 2^-MAX_CODE_LENGTH
+    for (uint8_t len : lengths) {
+        if (len > MAX_CODE_LENGTH) return false;
+        if (len != 0) kraft += 1ull << (MAX_CODE_LENGTH - len);
+    }
+    return kraft <= (1ull << MAX_CODE_LENGTH);
+}
+
+// Функция для назначения канонических кодов по длинам (символы по возрастанию длины, затем номера)
+void assignCanonicalCodes(UnicodeModel& model) {
+    vector<pair<int, int>> order; // (длина, номер)
+    for (size_t i = 0; i < model.lengths.size(); i++) {
+        if (model.lengths[i] != 0) order.push_back(make_pair((int)model.lengths[i], (int)i));
+    }
+    sort(order.begin(), order.end());
+
+    model.codes.assign(model.lengths.size(), 0);
+    uint32_t code = 0;
+    int prevLength = order.empty() ? 0 : order[0].first;
+    for (const auto& elem : order) {
+        code <<= (elem.first - prevLength);
+        prevLength = elem.first;
+        model.codes[elem.second] = code++;
+    }
+}
+
+// Функция для заполнения индексов поиска номера символа по кодовой точке
+void buildModelIndex(UnicodeModel& model) {
+    model.denseIndex.assign(WideHistogram::DENSE_SIZE, -1);
+    model.sparseIndex.clear();
+    for (size_t i = 0; i < model.symbols.size(); i++) {
+        uint32_t cp = model.symbols[i];
+        if (cp < WideHistogram::DENSE_SIZE) model.denseIndex[cp] = (int)i;
+        else model.sparseIndex[cp] = (int)i;
+    }
+}
+
+// Функция для ограничения длин кодов методом package-merge (как limitCodeLengths в lr2n5):
+// оптимальные длины при условии, что ни одна не больше maxLength.
+// weights - (номер символа модели, частота), lengths - длины по номерам символов
+void limitCodeLengths(const vector<pair<int, uint64_t>>& weights, vector<uint8_t>& lengths, int maxLength) {
+    struct Item {
+        uint64_t weight;
+        int symbol; // -1 у пакета
+        int first;  // у пакета - индекс первого из двух элементов предыдущего уровня
+    };
+
+    vector<Item> leaves;
+    for (const auto& elem : weights) {
+        if (elem.second != 0) leaves.push_back({ elem.second, elem.first, -1 });
+    }
+    sort(leaves.begin(), leaves.end(), [](const Item& a, const Item& b) {
+        if (a.weight == b.weight) return a.symbol < b.symbol;
+        return a.weight < b.weight;
+        });
+    fill(lengths.begin(), lengths.end(), 0);
+    size_t n = leaves.size();
+    if (n == 0) return;
+    if (n == 1) {
+        lengths[leaves[0].symbol] = 1;
+        return;
+    }
+    if (((size_t)1 << maxLength) < n) {
+        throw runtime_error("Ошибка: " + to_string(n) + " символов не помещаются в коды длиной "
+            + to_string(maxLength) + " бит");
+    }
+
+    vector<vector<Item>> levels(maxLength);
+    levels[0] = leaves;
+    for (int level = 1; level < maxLength; level++) {
+        const vector<Item>& prev = levels[level - 1];
+        vector<Item>& current = levels[level];
+        current.reserve(n + prev.size() / 2);
+        size_t leaf = 0;
+        size_t pair = 0;
+        while (leaf < n || pair + 1 < prev.size()) {
+            bool takeLeaf = pair + 1 >= prev.size()
+                || (leaf < n && leaves[leaf].weight <= prev[pair].weight + prev[pair + 1].weight);
+            if (takeLeaf) {
+                current.push_back(leaves[leaf++]);
+            }
+            else {
+                current.push_back({ prev[pair].weight + prev[pair + 1].weight, -1, (int)pair });
+                pair += 2;
+            }
+        }
+    }
+
+    // Разворачиваем выбранные элементы сверху вниз
+    vector<char> selected(levels[maxLength - 1].size(), 0);
+    fill(selected.begin(), selected.begin() + (2 * n - 2), 1);
+    for (int level = maxLength - 1; level >= 0; level--) {
+        vector<char> below(level > 0 ? levels[level - 1].size() : 0, 0);
+        for (size_t i = 0; i < levels[level].size(); i++) {
+            if (!selected[i]) continue;
+            const Item& item = levels[level][i];
+            if (item.symbol >= 0) {
+                lengths[item.symbol]++;
+            }
+            else {
+                below[item.first] = 1;
+                below[item.first + 1] = 1;
+            }
+        }
+        selected.swap(below);
+    }
+}
+
+// Функция для построения модели по частотам: самые частые символы + ESCAPE для остальных.
+// keepEscape - ESCAPE получает код, даже если все символы попали в модель
+// (нужно адаптивному режиму, где могут встретиться новые символы)
+UnicodeModel buildUnicodeModel(const WideHistogram& histogram, bool keepEscape = false) {
+    vector<pair<int, uint64_t>> items = histogram.items();
+    sort(items.begin(), items.end(), [](const pair<int, uint64_t>& a, const pair<int, uint64_t>& b) {
+        if (a.second != b.second) return a.second > b.second;
+        return a.first < b.first;
+        });
+
+    UnicodeModel model;
+    uint64_t escapeFrequency = 0;
+    vector<pair<int, uint64_t>> weights; // (номер символа модели, частота)
+    for (size_t i = 0; i < items.size(); i++) {
+        if (i < MAX_MODEL_SYMBOLS) {
+            weights.push_back(make_pair((int)model.symbols.size(), items[i].second));
+            model.symbols.push_back((uint32_t)items[i].first);
+        }
+        else {
+            escapeFrequency += items[i].second;
+        }
+    }
+    if (keepEscape) escapeFrequency++;
+    if (escapeFrequency != 0) {
+        weights.push_back(make_pair(model.escape(), escapeFrequency));
+    }
+
+    model.lengths.assign(model.symbols.size() + 1, 0);
+    bool tooLong = false; //дерево глубже MAX_CODE_LENGTH - длины строятся package-merge
+    for (const FlatNode& node : buildFlatHuffmanTree(weights)) {
+        if (node.symbol < 0) break;
+        if (node.depth > MAX_CODE_LENGTH) {
+            tooLong = true;
+            break;
+        }
+        model.lengths[node.symbol] = (uint8_t)max(node.depth, 1);
+    }
+    if (tooLong) limitCodeLengths(weights, model.lengths, MAX_CODE_LENGTH);
+    assignCanonicalCodes(model);
+    buildModelIndex(model);
+    return model;
+}
+
+// Таблица для декодирования: короткие коды - одним обращением,
+// длинные - через первые коды каждой длины
+struct DecodeTable {
+    vector<uint16_t> symbol;
+    vector<uint8_t> length; // 0 - код длиннее DECODE_TABLE_BITS
+    uint32_t firstCode[MAX_CODE_LENGTH + 1];
+    int firstIndex[MAX_CODE_LENGTH + 1];
+    int count[MAX_CODE_LENGTH + 1];
+    vector<uint16_t> sortedSymbols;
+    int maxLength;
+};
+
+DecodeTable buildDecodeTable(const UnicodeModel& model) {
+    DecodeTable table;
+    table.symbol.assign(1 << DECODE_TABLE_BITS, 0);
+    table.length.assign(1 << DECODE_TABLE_BITS, 0);
+    fill(begin(table.count), end(table.count), 0);
+    fill(begin(table.firstCode), end(table.firstCode), 0);
+    table.maxLength = 0;
+
+    vector<pair<int, int>> order; // (длина, номер) - канонический порядок
+    for (size_t i = 0; i < model.lengths.size(); i++) {
+        int len = model.lengths[i];
+        if (len == 0) continue;
+        order.push_back(make_pair(len, (int)i));
+        table.count[len]++;
+        table.maxLength = max(table.maxLength, len);
+    }
+    sort(order.begin(), order.end());
+    for (size_t k = 0; k < order.size(); k++) {
+        int len = order[k].first;
+        if (k == 0 || order[k - 1].first != len) {
+            table.firstIndex[len] = (int)k;
+            table.firstCode[len] = model.codes[order[k].second];
+        }
+        table.sortedSymbols.push_back((uint16_t)order[k].second);
+
+        if (len <= DECODE_TABLE_BITS) {
+            uint32_t first = model.codes[order[k].second] << (DECODE_TABLE_BITS - len);
+            uint32_t last = first + (1u << (DECODE_TABLE_BITS - len));
+            for (uint32_t i = first; i < last; i++) {
+                table.symbol[i] = (uint16_t)order[k].second;
+                table.length[i] = (uint8_t)len;
+            }
+        }
+    }
+    return table;
+}
+
+// Функция для декодирования номера одного символа модели
+inline int decodeSymbol(BitReader& reader, const DecodeTable& table) {
+    reader.refill();
+    uint32_t index = reader.peek(DECODE_TABLE_BITS);
+    int len = table.length[index];
+    if (len != 0) {
+        reader.skip(len);
+        return table.symbol[index];
+    }
+
+    uint32_t bits = reader.peek(MAX_CODE_LENGTH);
+    for (len = DECODE_TABLE_BITS + 1; len <= table.maxLength; len++) {
+        uint32_t code = bits >> (MAX_CODE_LENGTH - len);
+        if (code - table.firstCode[len] < (uint32_t)table.count[len]) {
+            reader.skip(len);
+            return table.sortedSymbols[table.firstIndex[len] + (code - table.firstCode[len])];
+        }
+    }
+    throw runtime_error("Ошибка: повреждённый поток Хаффмана");
+}
+
+// Итоги сжатия - для вывода и замеров
+struct CompressStats {
+    uint64_t originalSize;
+    uint64_t compressedSize;
+    uint64_t symbolCount;
+    size_t modelSize;
+};
+
+// Функция для сжатия UTF-8 потока: первый проход - частоты и CRC, второй - кодирование
+// (вход должен поддерживать seekg)
+CompressStats compressUtf8(istream& in, ostream& out) {
+    WideHistogram histogram;
+    uint64_t originalSize = 0;
+    uint64_t symbolCount = 0;
+    uint32_t crc = 0;
+    readCodePoints(in, [&](const vector<uint32_t>& symbols, const uint8_t* bytes, size_t byteCount) {
+        for (uint32_t cp : symbols) histogram.add(cp);
+        symbolCount += symbols.size();
+        originalSize += byteCount;
+        crc = crc32Update(crc, bytes, byteCount);
+        });
+    UnicodeModel model = buildUnicodeModel(histogram);
+
+    out.write(UTF8_FILE_MAGIC, sizeof(UTF8_FILE_MAGIC));
+    out.put((char)UTF8_FILE_VERSION);
+    writeLE(out, originalSize, 8);
+    writeLE(out, symbolCount, 8);
+    writeLE(out, crc, 4);
+    writeLE(out, model.symbols.size(), 4);
+    for (size_t i = 0; i < model.symbols.size(); i++) {
+        writeLE(out, model.symbols[i], 4);
+        writeLE(out, model.lengths[i], 1);
+    }
+    writeLE(out, model.lengths[model.escape()], 1);
+    uint64_t compressedSize = 4 + 1 + 8 + 8 + 4 + 4 + 5 * model.symbols.size() + 1;
+
+    in.clear();
+    in.seekg(0);
+    vector<uint8_t> encoded;
+    BitWriter writer(encoded);
+    int escape = model.escape();
+    readCodePoints(in, [&](const vector<uint32_t>& symbols, const uint8_t*, size_t) {
+        for (uint32_t cp : symbols) {
+            int index = model.indexOf(cp);
+            if (index >= 0) {
+                writer.put(model.codes[index], model.lengths[index]);
+            }
+            else {
+                writer.put(model.codes[escape], model.lengths[escape]);
+                writer.put(cp, ESCAPE_BITS);
+            }
+        }
+        out.write((const char*)encoded.data(), encoded.size());
+        compressedSize += encoded.size();
+        encoded.clear();
+        });
+    writer.flush();
+    out.write((const char*)encoded.data(), encoded.size());
+    compressedSize += encoded.size();
+    return { originalSize, compressedSize, symbolCount, model.symbols.size() };
+}
+
+// Функция для сжатия UTF-8 файла с выводом итогов
+void compressUtf8File(const string& inputPath, const string& outputPath) {
+    ifstream in(inputPath, ios::binary);
+    if (!in) {
+        throw runtime_error("Ошибка: не удалось открыть " + inputPath);
+    }
+    ofstream out(outputPath, ios::binary);
+    if (!out) {
+        throw runtime_error("Ошибка: не удалось создать " + outputPath);
+    }
+    auto start = chrono::steady_clock::now();
+    CompressStats stats = compressUtf8(in, out);
+    if (!out) {
+        throw runtime_error("Ошибка записи в " + outputPath);
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Сжато: " << stats.originalSize << " -> " << stats.compressedSize << " байт, символов: " << stats.symbolCount
+        << ", символов в модели: " << stats.modelSize
+        << ", скорость: " << stats.originalSize / 1e6 / max(seconds, 1e-9) << " МБ/с" << endl;
+}
+
+// Функция для распаковки потока с проверкой размера и CRC, возвращает число записанных байт
+uint64_t decompressUtf8(istream& in, ostream& out) {
+    char magic[4];
+    in.read(magic, sizeof(magic));
+    if (in.gcount() != sizeof(magic) || !equal(magic, magic + 4, UTF8_FILE_MAGIC)) {
+        throw runtime_error("Ошибка: это не файл, сжатый proba");
+    }
+    uint8_t version = (uint8_t)readLE(in, 1);
+    if (version != UTF8_FILE_VERSION) {
+        throw runtime_error("Ошибка: неподдерживаемая версия формата " + to_string(version));
+    }
+    uint64_t originalSize = readLE(in, 8);
+    uint64_t symbolCount = readLE(in, 8);
+    uint32_t expectedCrc = (uint32_t)readLE(in, 4);
+    uint64_t modelSize = readLE(in, 4);
+    if (modelSize > MAX_MODEL_SYMBOLS) {
+        throw runtime_error("Ошибка: слишком большая модель в заголовке");
+    }
+
+    UnicodeModel model;
+    model.symbols.resize(modelSize);
+    model.lengths.resize(modelSize + 1);
+    for (size_t i = 0; i <= modelSize; i++) {
+        if (i < modelSize) model.symbols[i] = (uint32_t)readLE(in, 4);
+        model.lengths[i] = (uint8_t)readLE(in, 1);
+    }
+    if (!validCodeLengths(model.lengths)) {
+        throw runtime_error("Ошибка: заголовок файла повреждён (недопустимые длины кодов)");
+    }
+    assignCanonicalCodes(model);
+    DecodeTable table = buildDecodeTable(model);
+
+    BitReader reader(in);
+    vector<uint8_t> block;
+    block.reserve(STREAM_CHUNK_SIZE + 4);
+    uint64_t written = 0;
+    uint32_t crc = 0;
+    int escape = model.escape();
+    for (uint64_t i = 0; i < symbolCount; i++) {
+        int index = decodeSymbol(reader, table);
+        uint32_t cp;
+        if (index == escape) {
+            reader.refill();
+            cp = reader.peek(ESCAPE_BITS);
+            reader.skip(ESCAPE_BITS);
+            if (cp >= RAW_BYTE_BASE + 256) {
+                throw runtime_error("Ошибка: повреждённый поток Хаффмана");
+            }
+        }
+        else {
+            cp = model.symbols[index];
+        }
+        uint8_t bytes[4];
+        int n = encodeUtf8(cp, bytes);
+        block.insert(block.end(), bytes, bytes + n);
+        if (block.size() >= STREAM_CHUNK_SIZE) {
+            crc = crc32Update(crc, block.data(), block.size());
+            out.write((const char*)block.data(), block.size());
+            written += block.size();
+            block.clear();
+        }
+    }
+    crc = crc32Update(crc, block.data(), block.size());
+    out.write((const char*)block.data(), block.size());
+    written += block.size();
+
+    if (written != originalSize || crc != expectedCrc) {
+        throw runtime_error("Ошибка: контрольная сумма не совпадает, данные повреждены");
+    }
+    return written;
+}
+
+// Функция для распаковки файла с выводом итогов
+void decompressUtf8File(const string& inputPath, const string& outputPath) {
+    ifstream in(inputPath, ios::binary);
+    if (!in) {
+        throw runtime_error("Ошибка: не удалось открыть " + inputPath);
+    }
+    ofstream out(outputPath, ios::binary);
+    if (!out) {
+        throw runtime_error("Ошибка: не удалось создать " + outputPath);
+    }
+    auto start = chrono::steady_clock::now();
+    uint64_t written = decompressUtf8(in, out);
+    if (!out) {
+        throw runtime_error("Ошибка записи в " + outputPath);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Распаковано: " << written << " байт, скорость: "
+        << written / 1e6 / max(seconds, 1e-9) << " МБ/с" << endl;
+}
+
+// ------------------- Адаптивное потоковое сжатие -------------------
+//
+// Частоты заранее не известны: кодер и декодер начинают с пустой модели
+// (есть только ESCAPE) и после каждого блока обновляют её по только что
+// обработанным символам. Хватает одного прохода, вход может быть каналом.
+//
+// Формат потока:
+//   "HUA8", версия (1 байт)
+//   блоки: число символов (4), число байтов (4), размер битового потока (4),
+//          CRC-32 байтов блока (4), битовый поток блока
+//   блок с числом символов 0 - конец потока
+
+const char ADAPTIVE_MAGIC[4] = { 'H', 'U', 'A', '8' };
+const uint8_t ADAPTIVE_VERSION = 1;
+const size_t ADAPTIVE_FIRST_BLOCK = 1 << 8;     // первые блоки маленькие, чтобы модель быстрее обучилась
+const size_t ADAPTIVE_BLOCK_SIZE = 1 << 14;     // байтов UTF-8 на блок - это и есть задержка
+const uint64_t ADAPTIVE_AGING_LIMIT = 1 << 18;  // при большей сумме частоты делятся пополам
+
+// Модель, которую кодер и декодер обновляют одинаково
+struct AdaptiveUnicodeModel {
+    WideHistogram histogram;
+    uint64_t total;
+    UnicodeModel model;
+
+    AdaptiveUnicodeModel() : total(0) {
+        model = buildUnicodeModel(histogram, true);
+    }
+
+    void update(const vector<uint32_t>& symbols) {
+        for (uint32_t cp : symbols) histogram.add(cp);
+        total += symbols.size();
+        while (total > ADAPTIVE_AGING_LIMIT) {
+            total = histogram.halve();
+        }
+        model = buildUnicodeModel(histogram, true);
+    }
+};
+
+// Открывает файл или возвращает стандартный поток для пути "-"
+istream& openInput(const string& path, ifstream& file) {
+    if (path == "-") return cin;
+    file.open(path, ios::binary);
+    if (!file) {
+        throw runtime_error("Ошибка: не удалось открыть " + path);
+    }
+    return file;
+}
+
+ostream& openOutput(const string& path, ofstream& file) {
+    if (path == "-") return cout;
+    file.open(path, ios::binary);
+    if (!file) {
+        throw runtime_error("Ошибка: не удалось создать " + path);
+    }
+    return file;
+}
+
+// Функция для адаптивного сжатия UTF-8 за один проход
+void compressAdaptive(const string& inputPath, const string& outputPath) {
+    ifstream inFile;
+    ofstream outFile;
+    istream& in = openInput(inputPath, inFile);
+    ostream& out = openOutput(outputPath, outFile);
+
+    out.write(ADAPTIVE_MAGIC, sizeof(ADAPTIVE_MAGIC));
+    out.put((char)ADAPTIVE_VERSION);
+
+    AdaptiveUnicodeModel adaptive;
+    vector<uint8_t> encoded;
+    readCodePoints(in, [&](const vector<uint32_t>& symbols, const uint8_t* bytes, size_t byteCount) {
+        if (symbols.empty()) return;
+        const UnicodeModel& model = adaptive.model;
+        int escape = model.escape();
+        encoded.clear();
+        BitWriter writer(encoded);
+        for (uint32_t cp : symbols) {
+            int index = model.indexOf(cp);
+            if (index >= 0) {
+                writer.put(model.codes[index], model.lengths[index]);
+            }
+            else {
+                writer.put(model.codes[escape], model.lengths[escape]);
+                writer.put(cp, ESCAPE_BITS);
+            }
+        }
+        writer.flush();
+
+        writeLE(out, symbols.size(), 4);
+        writeLE(out, byteCount, 4);
+        writeLE(out, encoded.size(), 4);
+        writeLE(out, crc32Update(0, bytes, byteCount), 4);
+        out.write((const char*)encoded.data(), encoded.size());
+        out.flush();
+
+        adaptive.update(symbols);
+        }, ADAPTIVE_BLOCK_SIZE, ADAPTIVE_FIRST_BLOCK);
+    writeLE(out, 0, 4);
+    out.flush();
+    if (!out) {
+        throw runtime_error("Ошибка записи в " + outputPath);
+    }
+}
+
+// Функция для адаптивной распаковки: модель повторяет действия кодера
+void decompressAdaptive(const string& inputPath, const string& outputPath) {
+    ifstream inFile;
+    ofstream outFile;
+    istream& in = openInput(inputPath, inFile);
+    ostream& out = openOutput(outputPath, outFile);
+
+    char magic[4];
+    in.read(magic, sizeof(magic));
+    if (in.gcount() != sizeof(magic) || !equal(magic, magic + 4, ADAPTIVE_MAGIC)) {
+        throw runtime_error("Ошибка: это не адаптивный поток proba");
+    }
+    uint8_t version = (uint8_t)readLE(in, 1);
+    if (version != ADAPTIVE_VERSION) {
+        throw runtime_error("Ошибка: неподдерживаемая версия формата " + to_string(version));
+    }
+
+    AdaptiveUnicodeModel adaptive;
+    DecodeTable table = buildDecodeTable(adaptive.model);
+    vector<uint8_t> encoded;
+    vector<uint8_t> block;
+    vector<uint32_t> symbols;
+    while (true) {
+        uint32_t symbolCount = (uint32_t)readLE(in, 4);
+        if (symbolCount == 0) break;
+        uint32_t byteCount = (uint32_t)readLE(in, 4);
+        uint32_t encodedSize = (uint32_t)readLE(in, 4);
+        uint32_t crc = (uint32_t)readLE(in, 4);
+        if (symbolCount > ADAPTIVE_BLOCK_SIZE + 4 || byteCount > ADAPTIVE_BLOCK_SIZE + 4
+            || encodedSize > (ADAPTIVE_BLOCK_SIZE + 4) * 8) {
+            throw runtime_error("Ошибка: повреждён заголовок блока");
+        }
+        encoded.resize(encodedSize);
+        in.read((char*)encoded.data(), encodedSize);
+        if ((uint32_t)in.gcount() != encodedSize) {
+            throw runtime_error("Ошибка: поток обрезан");
+        }
+
+        const UnicodeModel& model = adaptive.model;
+        int escape = model.escape();
+        BitReader reader(encoded.data(), encoded.size());
+        symbols.clear();
+        block.clear();
+        for (uint32_t i = 0; i < symbolCount; i++) {
+            int index = decodeSymbol(reader, table);
+            uint32_t cp;
+            if (index == escape) {
+                reader.refill();
+                cp = reader.peek(ESCAPE_BITS);
+                reader.skip(ESCAPE_BITS);
+                if (cp >= RAW_BYTE_BASE + 256) {
+                    throw runtime_error("Ошибка: повреждённый поток Хаффмана");
+                }
+            }
+            else {
+                cp = model.symbols[index];
+            }
+            symbols.push_back(cp);
+            uint8_t bytes[4];
+            int n = encodeUtf8(cp, bytes);
+            block.insert(block.end(), bytes, bytes + n);
+        }
+        if (block.size() != byteCount || crc32Update(0, block.data(), block.size()) != crc) {
+            throw runtime_error("Ошибка: контрольная сумма блока не совпадает");
+        }
+        out.write((const char*)block.data(), block.size());
+        out.flush();
+
+        adaptive.update(symbols);
+        table = buildDecodeTable(adaptive.model);
+    }
+    if (!out) {
+        throw runtime_error("Ошибка записи в " + outputPath);
+    }
+}
+
+// ------------------- Замеры скорости подсчёта частот -------------------
+
+// Функция для замера: возвращает миллионов символов в секунду (лучший из нескольких запусков)
+double measureThroughput(size_t symbols, const function<void()>& run, int repeats = 3) {
+    double best = 0;
+    for (int r = 0; r < repeats; r++) {
+        auto start = chrono::steady_clock::now();
+        run();
+        auto end = chrono::steady_clock::now();
+        double seconds = chrono::duration<double>(end - start).count();
+        best = max(best, symbols / 1e6 / max(seconds, 1e-9));
+    }
+    return best;
+}
+
+// Сравнение howOften (map), плотного массива и разреженной гистограммы
+void benchmarkHistogram(size_t millions) {
+    size_t size = millions * 1000000;
+    mt19937 gen(12345);
+    // В основном кириллица и пробелы, немного латиницы и редкие иероглифы
+    geometric_distribution<int> skewed(0.1);
+    uniform_int_distribution<int> percent(0, 99);
+    uniform_int_distribution<int> cjk(0x4E00, 0x4E00 + 3000);
+    wstring text(size, L' ');
+    for (wchar_t& c : text) {
+        int kind = percent(gen);
+        if (kind < 80) c = (wchar_t)(0x430 + min(skewed(gen), 31));
+        else if (kind < 95) c = L' ';
+        else if (kind < 99) c = (wchar_t)(L'a' + min(skewed(gen), 25));
+        else c = (wchar_t)cjk(gen);
+    }
+
+    cout << "Подсчёт частот, " << millions << " млн символов" << endl;
+    double mapSpeed = measureThroughput(size, [&] { volatile size_t n = howOften(text).size(); (void)n; });
+    double denseSpeed = measureThroughput(size, [&] { volatile size_t n = howOftenCounts(text).size(); (void)n; });
+    double sparseSpeed = measureThroughput(size, [&] { volatile size_t n = howOftenSparse(text).used; (void)n; });
+    cout << "howOften (map):       " << mapSpeed << " млн символов/с" << endl;
+    cout << "howOftenCounts:       " << denseSpeed << " млн символов/с" << endl;
+    cout << "howOftenSparse:       " << sparseSpeed << " млн символов/с" << endl;
+
+    // Проверяем, что разреженная гистограмма совпадает с map
+    map<wchar_t, int> expected = howOften(text);
+    vector<pair<int, uint64_t>> actual = howOftenSparse(text).items();
+    bool same = expected.size() == actual.size();
+    size_t i = 0;
+    for (auto it = expected.begin(); same && it != expected.end(); ++it, ++i) {
+        same = (int)it->first == actual[i].first && (uint64_t)it->second == actual[i].second;
+    }
+    cout << (same ? "Результаты совпадают" : "Ошибка: результаты различаются!") << endl;
+}
+
+// ------------------- Замеры скорости построения дерева -------------------
+
+// Функция для подсчёта суммарной длины кода (частота * глубина листа)
+uint64_t weightedPathLength(HuffmanNode* node, int depth = 0) {
+    if (node == nullptr) return 0;
+    if (node->left == nullptr && node->right == nullptr) {
+        return node->frequency * max(depth, 1);
+    }
+    return weightedPathLength(node->left, depth + 1) + weightedPathLength(node->right, depth + 1);
+}
+
+// Сравнение построения дерева: старая пересортировка, куча и две очереди
+void benchmarkTreeBuild() {
+    const size_t SORTED_LIMIT = 4096; // старый вариант дальше слишком медленный
+    vector<size_t> alphabetSizes = { 16, 256, 4096, 65536 };
+    mt19937 gen(12345);
+    uniform_int_distribution<int> freq(1, 1000000);
+
+    cout << "Построение дерева Хаффмана, время в мкс" << endl;
+    cout << "  Алфавит   пересортировка        куча   две очереди   длины совпадают" << endl;
+    for (size_t n : alphabetSizes) {
+        map<wchar_t, int> frequency;
+        vector<uint64_t> counts(n + 1, 0);
+        for (size_t s = 1; s <= n; s++) {
+            int f = freq(gen);
+            frequency[(wchar_t)s] = f;
+            counts[s] = (uint64_t)f;
+        }
+
+        auto start = chrono::steady_clock::now();
+        PriorityQueue heapNodes = createList(frequency);
+        HuffmanNode* heapTree = buildHuffmanTree(heapNodes);
+        double heapTime = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        vector<FlatNode> flatTree = buildFlatHuffmanTree(counts);
+        double flatTime = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+
+        uint64_t heapCost = weightedPathLength(heapTree);
+        uint64_t flatCost = 0;
+        for (const FlatNode& node : flatTree) {
+            if (node.symbol < 0) break;
+            flatCost += node.frequency * max(node.depth, 1);
+        }
+        bool same = heapCost == flatCost;
+
+        cout.width(9);
+        cout << n << "   ";
+        cout.width(14);
+        if (n <= SORTED_LIMIT) {
+            start = chrono::steady_clock::now();
+            ListQueue listNodes = createListQueue(frequency);
+            HuffmanNode* sortedTree = buildHuffmanTreeSorted(listNodes);
+            double sortedTime = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+            same = same && weightedPathLength(sortedTree) == heapCost;
+            cleanupHuffmanTree(sortedTree);
+            cout << (uint64_t)sortedTime;
+        }
+        else {
+            cout << "-";
+        }
+        cout << "   ";
+        cout.width(9);
+        cout << (uint64_t)heapTime << "   ";
+        cout.width(11);
+        cout << (uint64_t)flatTime << "   " << (same ? "да" : "НЕТ") << endl;
+        cleanupHuffmanTree(heapTree);
+    }
+}
+
+// ------------------- Общий замер сжатия -------------------
+
+// Функция для замера обоих построителей и кодека UTF-8 на всех наборах данных.
+// Результат печатается таблицей, а при заданном jsonPath ещё и пишется в JSON
+void benchmarkCompression(size_t megabytes, const string& jsonPath) {
+    size_t size = megabytes << 20;
+    string json = "{\n  \"program\": \"proba\",\n  \"corpus_bytes\": " + to_string(size) + ",\n  \"results\": [\n";
+
+    cout << "Набор       Символов  Энтропия,Б   Сжато,Б  Куча,мкс  Плоское,мкс  Сжатие,МБ/с  Распаковка,МБ/с" << endl;
+    for (size_t c = 0; c < CORPUS_NAMES.size(); c++) {
+        const string& name = CORPUS_NAMES[c];
+        string corpus = generateCorpus(name, size);
+
+        vector<uint32_t> codePoints;
+        decodeUtf8((const uint8_t*)corpus.data(), corpus.size(), true, codePoints);
+        wstring text(codePoints.begin(), codePoints.end());
+
+        // Построение дерева: очередь на куче и плоский массив
+        HuffmanNode* huffmanTree = nullptr;
+        double heapBuild = measureMicroseconds([&] {
+            PriorityQueue freeNodes = createList(howOften(text));
+            huffmanTree = buildHuffmanTree(freeNodes);
+            });
+        vector<FlatNode> flatTree;
+        double flatBuild = measureMicroseconds([&] { flatTree = buildFlatHuffmanTree(howOftenSparse(text).items()); });
+
+        uint64_t flatCost = 0;
+        double entropyBits = 0;
+        for (const FlatNode& node : flatTree) {
+            if (node.symbol < 0) break;
+            flatCost += node.frequency * max(node.depth, 1);
+            entropyBits -= node.frequency * log2((double)node.frequency / text.size());
+        }
+        bool sameCost = weightedPathLength(huffmanTree) == flatCost;
+        cleanupHuffmanTree(huffmanTree);
+
+        // Кодек UTF-8 в памяти
+        stringstream source(corpus);
+        stringstream packed;
+        stringstream unpacked;
+        CompressStats stats;
+        double encodeTime = measureMicroseconds([&] { stats = compressUtf8(source, packed); });
+        double decodeTime = measureMicroseconds([&] { decompressUtf8(packed, unpacked); });
+        if (unpacked.str() != corpus || !sameCost) {
+            throw runtime_error("Ошибка: набор " + name + " обработан неверно");
+        }
+
+        cout.setf(ios::fixed);
+        cout.precision(1);
+        cout << name << string(10 - name.size(), ' ');
+        cout.width(10); cout << text.size();
+        cout.width(12); cout << (uint64_t)(entropyBits / 8);
+        cout.width(10); cout << stats.compressedSize;
+        cout.width(10); cout << heapBuild;
+        cout.width(13); cout << flatBuild;
+        cout.width(13); cout << megabytesPerSecond(corpus.size(), encodeTime);
+        cout.width(17); cout << megabytesPerSecond(corpus.size(), decodeTime) << endl;
+
+        json += "    {\"corpus\": \"" + name + "\", \"bytes\": " + to_string(corpus.size())
+            + ", \"symbols\": " + to_string(text.size())
+            + ", \"entropy_bytes\": " + to_string((uint64_t)(entropyBits / 8))
+            + ", \"compressed_bytes\": " + to_string(stats.compressedSize)
+            + ", \"model_symbols\": " + to_string(stats.modelSize)
+            + ", \"build_us\": {\"heap\": " + to_string(heapBuild) + ", \"flat\": " + to_string(flatBuild) + "}"
+            + ", \"encode_mb_s\": " + to_string(megabytesPerSecond(corpus.size(), encodeTime))
+            + ", \"decode_mb_s\": " + to_string(megabytesPerSecond(corpus.size(), decodeTime)) + "}"
+            + (c + 1 < CORPUS_NAMES.size() ? ",\n" : "\n");
+    }
+    json += "  ]\n}\n";
+
+    if (!jsonPath.empty()) {
+        ofstream out(jsonPath);
+        out << json;
+        if (!out) {
+            throw runtime_error("Ошибка записи в " + jsonPath);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
     setlocale(LC_ALL, "ru");
 
+    // proba compress|decompress <вход> <выход> - сжатие UTF-8 файлов
+    // proba acompress|adecompress <вход> <выход> - адаптивный режим за один проход ("-" - stdin/stdout)
+    // proba histbench [млн символов] - замер подсчёта частот
+    // proba treebench - замер построения дерева для разных размеров алфавита
+    // proba bench [МБ] [файл для JSON] - замер на всех тестовых наборах
+    if (argc > 1) {
+        string command = argv[1];
+        bool fileCommand = command == "compress" || command == "decompress"
+            || command == "acompress" || command == "adecompress";
+        if (fileCommand && argc == 4) {
+            try {
+                if (command == "compress") compressUtf8File(argv[2], argv[3]);
+                else if (command == "decompress") decompressUtf8File(argv[2], argv[3]);
+                else if (command == "acompress") compressAdaptive(argv[2], argv[3]);
+                else decompressAdaptive(argv[2], argv[3]);
+            }
+            catch (const exception& e) {
+                cerr << e.what() << endl;
+                return 1;
+            }
+        }
+        else if (command == "histbench" && argc <= 3) {
+            benchmarkHistogram(argc == 3 ? stoul(argv[2]) : 20);
+        }
+        else if (command == "treebench" && argc == 2) {
+            benchmarkTreeBuild();
+        }
+        else if (command == "bench" && argc <= 4) {
+            try {
+                benchmarkCompression(argc >= 3 ? stoul(argv[2]) : 8, argc == 4 ? argv[3] : "");
+            }
+            catch (const exception& e) {
+                cerr << e.what() << endl;
+                return 1;
+            }
+        }
+        else {
+            cerr << "Использование:\n"
+                << "  " << argv[0] << " compress|decompress <входной файл> <выходной файл>\n"
+                << "  " << argv[0] << " acompress|adecompress <вход или -> <выход или ->\n"
+                << "  " << argv[0] << " histbench [млн символов]\n"
+                << "  " << argv[0] << " treebench\n"
+                << "  " << argv[0] << " bench [размер в МБ] [файл для JSON]" << endl;
+            return 1;
+        }
+        return 0;
+    }
+
     cout << "Введите исходную строку: ";
     wstring input;
     getline(wcin, input);
@@ -266,6 +1675,25 @@ int main() {
     generateHuffmanCodes(huffmanTree, "", huffmanCodes);
     printHuffmanCodes(huffmanCodes);
 
+    // То же дерево в плоском массиве и канонические коды
+    vector<FlatNode> flatTree = buildFlatHuffmanTree(howOftenSparse(input).items());
+    map<wchar_t, string> canonicalCodes = generateCanonicalCodes(flatTree);
+    wcout << L"\n=== КАНОНИЧЕСКИЕ КОДЫ (плоское дерево) ===";
+    printHuffmanCodes(canonicalCodes);
+
+    size_t treeBits = 0;
+    size_t flatBits = 0;
+    for (const auto& elem : frequency) {
+        treeBits += elem.second * huffmanCodes[elem.first].length();
+        flatBits += elem.second * canonicalCodes[elem.first].length();
+    }
+    wcout << L"Длина кода: дерево из указателей - " << treeBits << L" бит, плоское дерево - " << flatBits << L" бит" << endl;
+
     cleanupHuffmanTree(huffmanTree);
+    // Оба дерева оптимальны, поэтому общая длина кода обязана совпасть
+    if (treeBits != flatBits) {
+        cerr << "Ошибка: общая длина кода у дерева из указателей и плоского дерева различается" << endl;
+        return 1;
+    }
     return 0;
 }
\ No newline at end of file